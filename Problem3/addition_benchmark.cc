@@ -0,0 +1,90 @@
+//Counts allocations and time of a + b + c + ... with the operators of boost::addable used before,
+//with the move-aware operators and with Fibo::sum.
+//Build: g++ -std=c++17 -O2 addition_benchmark.cc fibo.cc -o addition_benchmark
+#include "fibo.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    size_t allocations = 0;
+
+    const size_t GROUPS = 2000;
+    const size_t DIGITS = 2000;
+
+    //How boost::addable defines the operator: the left operand is copied in and the result copied out
+    Fibo copyingAdd(Fibo lhs, const Fibo &rhs) {
+        return lhs += rhs;
+    }
+
+    Fibo randomFibo(std::mt19937 &random) {
+        std::string text = "1";
+
+        for (size_t i = 1; i < DIGITS; i++) {
+            text += random() % 2 == 0 ? '0' : '1';
+        }
+
+        return Fibo(text.c_str());
+    }
+
+    template<typename F>
+    void measure(const char *name, const std::vector<Fibo> &values, F add) {
+        size_t lengths = 0;
+        size_t before = allocations;
+        auto begin = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i + 8 <= values.size(); i += 8) {
+            lengths += add(&values[i]).length();
+        }
+
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::cout << name << ": " << double(allocations - before) / GROUPS << " allocations per sum, "
+                  << time / GROUPS * 1e6 << " us per sum (" << lengths << " digits)\n";
+    }
+}
+
+void *operator new(size_t size) {
+    allocations++;
+
+    if (void *result = std::malloc(size == 0 ? 1 : size)) {
+        return result;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+int main() {
+    std::mt19937 random(2020);
+    std::vector<Fibo> values;
+
+    for (size_t i = 0; i < 8 * GROUPS; i++) {
+        values.push_back(randomFibo(random));
+    }
+
+    measure("boost::addable", values, [](const Fibo *v) {
+        return copyingAdd(copyingAdd(copyingAdd(copyingAdd(copyingAdd(copyingAdd(copyingAdd(
+                v[0], v[1]), v[2]), v[3]), v[4]), v[5]), v[6]), v[7]);
+    });
+
+    measure("operator+", values, [](const Fibo *v) {
+        return v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6] + v[7];
+    });
+
+    measure("Fibo::sum", values, [](const Fibo *v) {
+        return Fibo::sum(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+    });
+}
@@ -0,0 +1,170 @@
+//Compares the Fibonacci code of 64-bit numbers with LEB128 varints: size of the code and speed of encoding
+//and decoding, on distributions skewed towards small numbers and on uniform ones. The table-driven decoder
+//is also compared with one reading a digit at a time.
+//Build: g++ -std=c++17 -O2 coding_benchmark.cc fibo.cc -o coding_benchmark
+#include "fibo.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    const size_t NUMBERS = 1 << 22;
+    const size_t REPEATS = 3;
+
+    std::vector<unsigned char> varintEncode(const std::vector<uint64_t> &numbers) {
+        std::vector<unsigned char> code;
+
+        for (uint64_t number : numbers) {
+            while (number >= 0x80) {
+                code.push_back((number & 0x7f) | 0x80);
+                number >>= 7;
+            }
+
+            code.push_back(number);
+        }
+
+        return code;
+    }
+
+    bool varintDecode(const std::vector<unsigned char> &code, std::vector<uint64_t> &numbers) {
+        uint64_t number = 0;
+        size_t shift = 0;
+
+        for (unsigned char byte : code) {
+            if (shift >= 64) {
+                return false;
+            }
+
+            number |= uint64_t(byte & 0x7f) << shift;
+            shift += 7;
+
+            if ((byte & 0x80) == 0) {
+                numbers.push_back(number);
+                number = 0;
+                shift = 0;
+            }
+        }
+
+        return shift == 0;
+    }
+
+    //Decodes a digit at a time, with 64-bit numbers only
+    bool digitDecode(const std::vector<unsigned char> &code, std::vector<uint64_t> &numbers) {
+        uint64_t previous = 1, current = 1, value = 0;
+        bool lastOne = false;
+
+        for (unsigned char byte : code) {
+            for (size_t k = 0; k < 8; k++) {
+                bool one = (byte >> k) & 1;
+
+                if (one && lastOne) {
+                    numbers.push_back(value - 1);
+                    previous = current = 1;
+                    value = 0;
+                    lastOne = false;
+
+                    continue;
+                }
+
+                if (one) {
+                    value += current;
+                }
+
+                uint64_t next = previous + current;
+                previous = current;
+                current = next;
+                lastOne = one;
+            }
+        }
+
+        return value == 0;
+    }
+
+    //Returns the best time of the operation in seconds
+    template<typename Operation>
+    double measure(Operation operation) {
+        double best = 0;
+
+        for (size_t repeat = 0; repeat < REPEATS; repeat++) {
+            auto begin = std::chrono::steady_clock::now();
+            operation();
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            best = repeat == 0 ? time : std::min(best, time);
+        }
+
+        return best;
+    }
+
+    //Speed in gigabytes of 64-bit numbers per second
+    double speed(double time) {
+        return NUMBERS * sizeof(uint64_t) / time / 1e9;
+    }
+
+    template<typename Encode, typename Decode>
+    void compare(const char *name, const std::vector<uint64_t> &numbers, Encode encode, Decode decode) {
+        std::vector<unsigned char> code = encode(numbers);
+        std::vector<uint64_t> decoded;
+        decoded.reserve(numbers.size());
+
+        if (!decode(code, decoded) || decoded != numbers) {
+            std::cout << name << " does not decode the numbers\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        double encodeTime = measure([&] {
+            code = encode(numbers);
+        });
+
+        double decodeTime = measure([&] {
+            decoded.clear();
+            decode(code, decoded);
+        });
+
+        std::cout << std::setw(14) << name << std::setw(12) << std::setprecision(3)
+                  << double(code.size()) * 8 / numbers.size() << std::setw(12) << speed(encodeTime)
+                  << std::setw(12) << speed(decodeTime) << '\n';
+    }
+}
+
+int main() {
+    std::mt19937_64 random(2020);
+    std::geometric_distribution<uint64_t> geometric(0.1);
+    std::exponential_distribution<double> exponential(1e-4);
+    std::vector<std::pair<std::string, std::vector<uint64_t>>> distributions(4);
+
+    distributions[0].first = "geometric, mean 9";
+    distributions[1].first = "exponential, mean 10^4";
+    distributions[2].first = "uniform bit length";
+    distributions[3].first = "uniform 64-bit";
+
+    for (size_t i = 0; i < NUMBERS; i++) {
+        distributions[0].second.push_back(geometric(random));
+        distributions[1].second.push_back(uint64_t(exponential(random)));
+        distributions[2].second.push_back(random() >> (random() % 64));
+        distributions[3].second.push_back(random());
+    }
+
+    for (const auto &distribution : distributions) {
+        std::cout << distribution.first << '\n' << std::setw(14) << "code" << std::setw(12) << "bits/number"
+                  << std::setw(12) << "encode GB/s" << std::setw(12) << "decode GB/s" << '\n';
+
+        compare("Fibonacci", distribution.second, [](const std::vector<uint64_t> &numbers) {
+            return fibonacciEncode(numbers);
+        }, [](const std::vector<unsigned char> &code, std::vector<uint64_t> &numbers) {
+            return fibonacciDecode(code, numbers);
+        });
+
+        compare("digit decoder", distribution.second, [](const std::vector<uint64_t> &numbers) {
+            return fibonacciEncode(numbers);
+        }, digitDecode);
+
+        compare("varint", distribution.second, varintEncode, varintDecode);
+    }
+}
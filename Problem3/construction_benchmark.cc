@@ -0,0 +1,128 @@
+//Compares construction of Fibo from integers with the constructor used before the table of Fibonacci numbers
+//was built at compile time: a lazily filled vector searched by bisection, digits kept in a vector<bool>.
+//Build: g++ -std=c++17 -O2 -pthread construction_benchmark.cc fibo.cc -o construction_benchmark
+#include "fibo.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+    const size_t NUMBERS = 1 << 20;
+    const size_t REPEATS = 5;
+
+    //Constructor from before, without its shared lazy initialization, which is not safe in threads
+    class OldFibo {
+    public:
+        explicit OldFibo(unsigned long long number) {
+            if (number == 0) {
+                representation.push_back(false);
+
+                return;
+            }
+
+            size_t biggestIndex = biggestSmallerIndex(number);
+
+            representation.resize(biggestIndex + 1);
+            representation[biggestIndex] = true;
+
+            unsigned long long rest = number - numbers()[biggestIndex];
+
+            for (size_t i = biggestIndex; rest > 0 && i-- > 0;) {
+                if (numbers()[i] <= rest) {
+                    rest -= numbers()[i];
+                    representation[i] = true;
+                }
+            }
+        }
+
+        size_t length() const {
+            return representation.size();
+        }
+
+    private:
+        std::vector<bool> representation;
+
+        static const std::vector<unsigned long long> &numbers() {
+            static const std::vector<unsigned long long> result = [] {
+                std::vector<unsigned long long> numbers{1, 2};
+
+                while (ULLONG_MAX - numbers.back() >= numbers[numbers.size() - 2]) {
+                    numbers.push_back(numbers.back() + numbers[numbers.size() - 2]);
+                }
+
+                return numbers;
+            }();
+
+            return result;
+        }
+
+        static size_t biggestSmallerIndex(unsigned long long number) {
+            size_t left = 0, right = numbers().size() - 1;
+
+            while (left != right) {
+                size_t index = (left + right + 1) / 2;
+
+                if (numbers()[index] > number) {
+                    right = index - 1;
+                } else {
+                    left = index;
+                }
+            }
+
+            return left;
+        }
+    };
+
+    //Returns the best time of constructing all numbers, split between the threads, in seconds
+    template<typename T>
+    double measure(const std::vector<uint64_t> &numbers, size_t threads) {
+        double best = 0;
+
+        for (size_t repeat = 0; repeat < REPEATS; repeat++) {
+            std::vector<size_t> lengths(threads);
+            std::vector<std::thread> workers;
+            auto begin = std::chrono::steady_clock::now();
+
+            for (size_t t = 0; t < threads; t++) {
+                workers.emplace_back([&numbers, &length = lengths[t], t, threads] {
+                    for (size_t i = numbers.size() * t / threads; i < numbers.size() * (t + 1) / threads; i++) {
+                        length += T(numbers[i]).length();
+                    }
+                });
+            }
+
+            for (std::thread &worker : workers) {
+                worker.join();
+            }
+
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            best = repeat == 0 ? time : std::min(best, time);
+        }
+
+        return best;
+    }
+}
+
+int main() {
+    std::mt19937_64 random(2020);
+    std::vector<uint64_t> numbers(NUMBERS);
+
+    //Bit lengths are uniform, so that small and big numbers are equally frequent
+    for (uint64_t &number : numbers) {
+        number = random() >> (random() % 64);
+    }
+
+    OldFibo(1);
+
+    std::cout << "old, 1 thread: " << NUMBERS / measure<OldFibo>(numbers, 1) / 1e6 << " M/s\n";
+
+    for (size_t threads = 1; threads <= std::max(std::thread::hardware_concurrency(), 1u); threads *= 2) {
+        std::cout << "new, " << threads << " threads: " << NUMBERS / measure<Fibo>(numbers, threads) / 1e6
+                  << " M/s\n";
+    }
+}
@@ -0,0 +1,350 @@
+//Compares every Fibo operation on random operands with a reference model: plain binary big integers.
+//Fibonacci coding of integer arrays is checked by round trips, also of the longest code words.
+//Malformed serializations, such as lengths too long for size_t, must be rejected.
+//Bitwise operations and shifts act on the digits of the Zeckendorf representation, so the model finds
+//them greedily, applies the operation to them and sums the Fibonacci numbers of the resulting ones.
+//Build: g++ -std=c++17 -O2 differential_fuzz.cc fibo.cc -o differential_fuzz
+//Run: ./differential_fuzz [iterations] [seed]
+#include "fibo.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+    const size_t MAX_DIGITS = 400;
+    const size_t MAX_SHIFT = 200;
+
+    //Non-negative integer in base 2^32, the lowest word first, without leading zero words
+    class BigInteger {
+    public:
+        BigInteger() = default;
+
+        explicit BigInteger(uint64_t number) {
+            while (number > 0) {
+                words.push_back(uint32_t(number));
+                number >>= 32;
+            }
+        }
+
+        BigInteger &operator+=(const BigInteger &rhs) {
+            uint64_t carry = 0;
+
+            words.resize(std::max(words.size(), rhs.words.size()), 0);
+
+            for (size_t i = 0; i < words.size(); i++) {
+                carry += uint64_t{words[i]} + (i < rhs.words.size() ? rhs.words[i] : 0);
+                words[i] = uint32_t(carry);
+                carry >>= 32;
+            }
+
+            if (carry > 0) {
+                words.push_back(uint32_t(carry));
+            }
+
+            return *this;
+        }
+
+        //The right operand is not greater
+        BigInteger &operator-=(const BigInteger &rhs) {
+            int64_t borrow = 0;
+
+            for (size_t i = 0; i < words.size(); i++) {
+                borrow += int64_t{words[i]} - (i < rhs.words.size() ? rhs.words[i] : 0);
+                words[i] = uint32_t(borrow);
+                borrow = borrow < 0 ? -1 : 0;
+            }
+
+            while (!words.empty() && words.back() == 0) {
+                words.pop_back();
+            }
+
+            return *this;
+        }
+
+        friend bool operator<(const BigInteger &lhs, const BigInteger &rhs) {
+            if (lhs.words.size() != rhs.words.size()) {
+                return lhs.words.size() < rhs.words.size();
+            }
+
+            return std::lexicographical_compare(lhs.words.rbegin(), lhs.words.rend(),
+                                                rhs.words.rbegin(), rhs.words.rend());
+        }
+
+        friend bool operator==(const BigInteger &lhs, const BigInteger &rhs) {
+            return lhs.words == rhs.words;
+        }
+
+        bool isZero() const {
+            return words.empty();
+        }
+
+    private:
+        std::vector<uint32_t> words;
+    };
+
+    //Fibonacci numbers from F_{2} = 1, enough for numbers with the given count of Zeckendorf digits
+    const std::vector<BigInteger> &fibonacciNumbers() {
+        static const std::vector<BigInteger> result = [] {
+            std::vector<BigInteger> numbers{BigInteger(1), BigInteger(2)};
+
+            while (numbers.size() < 2 * MAX_DIGITS + MAX_SHIFT + 4) {
+                BigInteger next = numbers.back();
+                next += numbers[numbers.size() - 2];
+                numbers.push_back(next);
+            }
+
+            return numbers;
+        }();
+
+        return result;
+    }
+
+    //Digits from the lowest, any zero and one digits are allowed
+    using Digits = std::vector<bool>;
+
+    BigInteger value(const Digits &digits) {
+        BigInteger result;
+
+        for (size_t i = 0; i < digits.size(); i++) {
+            if (digits[i]) {
+                result += fibonacciNumbers()[i];
+            }
+        }
+
+        return result;
+    }
+
+    Digits zeckendorf(BigInteger number) {
+        Digits result;
+        size_t index = 0;
+
+        while (index + 1 < fibonacciNumbers().size() && !(number < fibonacciNumbers()[index + 1])) {
+            index++;
+        }
+
+        for (size_t i = index + 1; i-- > 0;) {
+            if (!(number < fibonacciNumbers()[i])) {
+                number -= fibonacciNumbers()[i];
+
+                if (result.empty()) {
+                    result.resize(i + 1);
+                }
+
+                result[i] = true;
+            }
+        }
+
+        return result.empty() ? Digits{false} : result;
+    }
+
+    std::string text(const Digits &digits) {
+        std::string result;
+
+        for (size_t i = digits.size(); i-- > 0;) {
+            result += digits[i] ? '1' : '0';
+        }
+
+        return result;
+    }
+
+    std::string text(const Fibo &fibo) {
+        std::ostringstream os;
+        os << fibo;
+
+        return os.str();
+    }
+
+    Digits randomDigits(std::mt19937_64 &random) {
+        Digits result(1 + random() % MAX_DIGITS);
+
+        //Dense and sparse ones, so that additions both carry far and not at all
+        size_t density = 1 + random() % 4;
+
+        for (size_t i = 0; i < result.size(); i++) {
+            result[i] = random() % density == 0;
+        }
+
+        result.back() = true;
+
+        return result;
+    }
+
+    template<typename Operation>
+    Digits combine(const Digits &lhs, const Digits &rhs, Operation operation) {
+        Digits result(std::max(lhs.size(), rhs.size()));
+
+        for (size_t i = 0; i < result.size(); i++) {
+            result[i] = operation(i < lhs.size() && lhs[i], i < rhs.size() && rhs[i]);
+        }
+
+        return result;
+    }
+
+    size_t failures = 0;
+
+    void check(bool condition, const char *operation, const std::string &lhs, const std::string &rhs) {
+        if (!condition && failures++ < 10) {
+            std::cerr << operation << " failed for " << lhs << " and " << rhs << '\n';
+        }
+    }
+
+    //Checks that the number is normalized and equal to the expected one
+    void check(const Fibo &fibo, const BigInteger &expected, const char *operation,
+               const std::string &lhs, const std::string &rhs) {
+        std::string digits = text(fibo);
+        bool normalized = digits.find("11") == std::string::npos && (digits.size() == 1 || digits[0] == '1');
+
+        check(normalized && digits == text(zeckendorf(expected)) && fibo.length() == digits.size(),
+              operation, lhs, rhs);
+    }
+
+    //Around the biggest Fibonacci number F(93) and the biggest 64-bit number, whose code word is longest
+    const uint64_t EDGE_CODE_NUMBERS[] = {0, 1, 2, 7540113804746346428u, 12200160415121876736u,
+                                          12200160415121876737u, 12200160415121876738u, UINT32_MAX,
+                                          uint64_t{UINT32_MAX} + 1, UINT64_MAX - 1, UINT64_MAX};
+
+    std::string text(const std::vector<uint64_t> &numbers) {
+        std::string result;
+
+        for (uint64_t number : numbers) {
+            result += std::to_string(number) + ' ';
+        }
+
+        return result;
+    }
+
+    //Checks that the numbers are decoded from their Fibonacci code, and as 32-bit numbers only if they fit
+    void checkCode(const std::vector<uint64_t> &numbers) {
+        std::vector<uint64_t> decoded;
+        std::vector<uint32_t> narrow;
+        bool fits = std::all_of(numbers.begin(), numbers.end(), [](uint64_t number) {
+            return number <= UINT32_MAX;
+        });
+
+        check(fibonacciDecode(fibonacciEncode(numbers), decoded) && decoded == numbers,
+              "Fibonacci code", text(numbers), "");
+        check(fibonacciDecode(fibonacciEncode(numbers), narrow) == fits, "32-bit Fibonacci code", text(numbers), "");
+
+        if (fits) {
+            std::vector<uint32_t> original(numbers.begin(), numbers.end());
+            narrow.clear();
+
+            check(fibonacciDecode(fibonacciEncode(original), narrow) && narrow == original,
+                  "32-bit Fibonacci code", text(numbers), "");
+        }
+    }
+
+    //Serializations which are not Fibo values: lengths which do not fit in 64 bits, as the tenth byte has bits
+    //above the lowest one or continues, no digits, fewer bytes than the length needs and leading zeros
+    const std::string MALFORMED_SERIALIZATIONS[] = {
+            std::string("\xFC\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x01", 10),
+            std::string("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x02", 10),
+            std::string("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x81\x00", 11),
+            std::string("\x00", 1), std::string("\x09\x01", 2), std::string("\x02\x01", 2), std::string()};
+
+    std::string hex(const std::string &bytes) {
+        const char *digits = "0123456789ABCDEF";
+        std::string result;
+
+        for (unsigned char byte : bytes) {
+            result += {digits[byte >> 4], digits[byte & 15], ' '};
+        }
+
+        return result;
+    }
+
+    //Checks that the bytes are rejected by failing the stream
+    void checkMalformed(const std::string &bytes) {
+        std::stringstream stream(bytes);
+        Fibo::deserialize(stream);
+
+        check(!stream, "malformed serialization", hex(bytes), "");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t iterations = argc > 1 ? std::stoul(argv[1]) : 10000;
+    std::mt19937_64 random(argc > 2 ? std::stoul(argv[2]) : 2020);
+
+    for (uint64_t edge : EDGE_CODE_NUMBERS) {
+        checkCode({edge});
+        checkCode({edge, 0, edge, 1});
+    }
+
+    for (const std::string &malformed : MALFORMED_SERIALIZATIONS) {
+        checkMalformed(malformed);
+    }
+
+    for (size_t iteration = 0; iteration < iterations; iteration++) {
+        Digits lhsDigits = randomDigits(random), rhsDigits = randomDigits(random);
+        std::string lhsText = text(lhsDigits), rhsText = text(rhsDigits);
+        BigInteger lhsValue = value(lhsDigits), rhsValue = value(rhsDigits);
+
+        //The strings need not be normalized, Zeckendorf digits of the values are
+        Fibo lhs(lhsText.c_str()), rhs(lhsText == rhsText ? lhs : Fibo(rhsText));
+        Digits lhsZeckendorf = zeckendorf(lhsValue), rhsZeckendorf = zeckendorf(rhsValue);
+
+        check(lhs, lhsValue, "string constructor", lhsText, "");
+
+        uint64_t number = random() >> (random() % 64);
+        check(Fibo(number), BigInteger(number), "integer constructor", std::to_string(number), "");
+
+        BigInteger sumValue = lhsValue;
+        sumValue += rhsValue;
+        check(lhs + rhs, sumValue, "+", lhsText, rhsText);
+        check(Fibo(lhs) + Fibo(rhs), sumValue, "+ of temporaries", lhsText, rhsText);
+        check(Fibo::sum(lhs, rhs, lhs), value(lhsDigits) += sumValue, "sum", lhsText, rhsText);
+
+        Fibo doubled(lhs);
+        doubled += doubled;
+        check(doubled, value(lhsDigits) += lhsValue, "+= itself", lhsText, "");
+
+        check(lhs & rhs, value(combine(lhsZeckendorf, rhsZeckendorf, [](bool a, bool b) {
+            return a && b;
+        })), "&", lhsText, rhsText);
+        check(lhs | rhs, value(combine(lhsZeckendorf, rhsZeckendorf, [](bool a, bool b) {
+            return a || b;
+        })), "|", lhsText, rhsText);
+        check(lhs ^ rhs, value(combine(lhsZeckendorf, rhsZeckendorf, [](bool a, bool b) {
+            return a != b;
+        })), "^", lhsText, rhsText);
+        check((Fibo(lhs) &= rhs) == (lhs & rhs) && (Fibo(lhs) |= rhs) == (lhs | rhs) &&
+              (Fibo(lhs) ^= rhs) == (lhs ^ rhs), "compound bitwise", lhsText, rhsText);
+
+        size_t shift = random() % MAX_SHIFT;
+        Digits shifted(shift, false);
+        shifted.insert(shifted.end(), lhsZeckendorf.begin(), lhsZeckendorf.end());
+        check(lhs << shift, lhsValue.isZero() ? lhsValue : value(shifted), "<<", lhsText, std::to_string(shift));
+
+        check((lhs < rhs) == (lhsValue < rhsValue) && (lhs > rhs) == (rhsValue < lhsValue) &&
+              (lhs <= rhs) == !(rhsValue < lhsValue) && (lhs >= rhs) == !(lhsValue < rhsValue) &&
+              (lhs == rhs) == (lhsValue == rhsValue) && (lhs != rhs) == !(lhsValue == rhsValue),
+              "comparison", lhsText, rhsText);
+
+        std::unordered_set<Fibo> set{lhs};
+        check((set.count(rhs) == 1) == (lhs == rhs), "hash", lhsText, rhsText);
+
+        std::stringstream stream;
+        lhs.serialize(stream);
+        check(Fibo::deserialize(stream) == lhs && stream, "serialization", lhsText, "");
+
+        std::vector<uint64_t> numbers(random() % 20);
+
+        for (uint64_t &element : numbers) {
+            element = random() >> (random() % 64);
+        }
+
+        checkCode(numbers);
+    }
+
+    std::cout << iterations << " iterations, " << failures << " failures\n";
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,61 +2,569 @@
 
 #include <string>
 #include <ostream>
+#include <istream>
 #include <vector>
+#include <array>
 #include <cstring>
 #include <climits>
+#include <cstdint>
+#include <limits>
 #include <cassert>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 
 using std::string;
 using std::ostream;
+using std::istream;
 using std::vector;
+using std::array;
 
 namespace {
     using fibonacci_number_type = unsigned long long;
     const fibonacci_number_type MAX_FIBBONACCI_NUMBER_TYPE = ULLONG_MAX;
-
-    //Fibonacci numbers from F_{2} = 1
-    vector<fibonacci_number_type> fibonacciNumbers;
+    const size_t NUMBER_TYPE_BITS = sizeof(fibonacci_number_type) * CHAR_BIT;
 
     size_t stringLength(const char *text) {
         assert(text != nullptr);
         return strlen(text);
     }
 
-    void calculateFibonacciNumbers() {
-        if (!fibonacciNumbers.empty()) {
-            return;
+    constexpr size_t countFibonacciNumbers() {
+        fibonacci_number_type previous = 1, current = 2;
+        size_t count = 2;
+
+        while (MAX_FIBBONACCI_NUMBER_TYPE - current >= previous) {
+            fibonacci_number_type next = previous + current;
+            previous = current;
+            current = next;
+            count++;
         }
 
-        fibonacciNumbers.push_back(1);
-        fibonacciNumbers.push_back(2);
+        return count;
+    }
+
+    const size_t FIBONACCI_NUMBERS_COUNT = countFibonacciNumbers();
+
+    constexpr array<fibonacci_number_type, FIBONACCI_NUMBERS_COUNT> calculateFibonacciNumbers() {
+        array<fibonacci_number_type, FIBONACCI_NUMBERS_COUNT> result{};
+
+        result[0] = 1;
+        result[1] = 2;
+
+        for (size_t i = 2; i < FIBONACCI_NUMBERS_COUNT; i++) {
+            result[i] = result[i - 1] + result[i - 2];
+        }
+
+        return result;
+    }
+
+    //Fibonacci numbers from F_{2} = 1, fixed at compile time so no initialization is shared between threads
+    constexpr array<fibonacci_number_type, FIBONACCI_NUMBERS_COUNT> fibonacciNumbers = calculateFibonacciNumbers();
+
+    //Numbers with the same bit length and the same second highest bit form an interval
+    //whose ends differ less than by the golden ratio, so it contains at most one Fibonacci number
+    constexpr size_t intervalIndex(fibonacci_number_type number) {
+        size_t bitLength = NUMBER_TYPE_BITS - __builtin_clzll(number);
+        size_t secondBit = bitLength > 1 ? (number >> (bitLength - 2)) & 1 : 0;
+
+        return 2 * bitLength + secondBit;
+    }
+
+    //For every interval the index of the biggest Fibonacci number not greater than its beginning
+    constexpr array<size_t, 2 * NUMBER_TYPE_BITS + 2> calculateIndexEstimates() {
+        array<size_t, 2 * NUMBER_TYPE_BITS + 2> result{};
+        size_t index = 0;
+
+        for (size_t bitLength = 1; bitLength <= NUMBER_TYPE_BITS; bitLength++) {
+            for (size_t secondBit = 0; secondBit < 2; secondBit++) {
+                if (bitLength == 1 && secondBit == 1) {
+                    continue;
+                }
 
-        int i = 2;
+                fibonacci_number_type begin = fibonacci_number_type{1} << (bitLength - 1);
+                if (secondBit == 1) {
+                    begin |= begin >> 1;
+                }
+
+                while (index + 1 < FIBONACCI_NUMBERS_COUNT && fibonacciNumbers[index + 1] <= begin) {
+                    index++;
+                }
 
-        while (MAX_FIBBONACCI_NUMBER_TYPE - fibonacciNumbers[i - 1] >= fibonacciNumbers[i - 2]) {
-            fibonacciNumbers.push_back(fibonacciNumbers[i - 1] + fibonacciNumbers[i - 2]);
-            i++;
+                result[2 * bitLength + secondBit] = index;
+            }
         }
+
+        return result;
+    }
+
+    constexpr array<size_t, 2 * NUMBER_TYPE_BITS + 2> indexEstimates = calculateIndexEstimates();
+
+    const size_t DIGITS_IN_BYTE = 8;
+    const size_t LENGTH_BITS_IN_BYTE = 7;
+    const unsigned char LENGTH_CONTINUES = 0x80;
+    const size_t MAX_READ_CHUNK = 1 << 16;
+    const uint64_t HASH_MULTIPLIER = 0x9e3779b97f4a7c15;
+
+    //Does not overflow for lengths close to the maximum of size_t
+    size_t packedSize(size_t length) {
+        return length / DIGITS_IN_BYTE + (length % DIGITS_IN_BYTE != 0);
+    }
+
+    //Reads length written in bytes of seven bits, lowest first, with the highest bit set in all but the last one.
+    //Fails if the length does not fit in size_t.
+    bool readLength(istream &is, size_t &length) {
+        const size_t lengthBits = sizeof(size_t) * CHAR_BIT;
+        length = 0;
+
+        for (size_t shift = 0; shift < lengthBits; shift += LENGTH_BITS_IN_BYTE) {
+            int byte = is.get();
+
+            if (byte == istream::traits_type::eof()) {
+                return false;
+            }
+
+            size_t bits = byte & ~LENGTH_CONTINUES;
+
+            if (shift + LENGTH_BITS_IN_BYTE > lengthBits
+                && ((bits >> (lengthBits - shift)) != 0 || (byte & LENGTH_CONTINUES) != 0)) {
+                return false;
+            }
+
+            length |= bits << shift;
+
+            if ((byte & LENGTH_CONTINUES) == 0) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    //Reads in chunks, so that a corrupted length does not allocate memory for data that is not there
+    bool readBytes(istream &is, size_t count, vector<unsigned char> &bytes) {
+        bytes.clear();
+
+        while (bytes.size() < count) {
+            size_t begin = bytes.size();
+            size_t chunk = std::min(count - begin, MAX_READ_CHUNK);
+
+            bytes.resize(begin + chunk);
+            is.read(reinterpret_cast<char *>(bytes.data() + begin), chunk);
+
+            if (!is) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    uint64_t loadWord(const unsigned char *bytes, size_t size) {
+        uint64_t word = 0;
+
+        for (size_t i = 0; i < size; i++) {
+            word |= uint64_t{bytes[i]} << (DIGITS_IN_BYTE * i);
+        }
+
+        return word;
     }
 }
 
-//Finds and returns the index of the biggest Fibonacci number smaller than the given number
-size_t Fibo::biggestSmallerFibbonacciNumberIndex(fibonacci_number_type number) {
-    calculateFibonacciNumbers();
+namespace {
+    size_t biggestIndex(fibonacci_number_type number) {
+        assert(number > 0);
+
+        size_t index = indexEstimates[intervalIndex(number)];
 
-    size_t left = 0, right = fibonacciNumbers.size() - 1;
+        return index + (index + 1 < FIBONACCI_NUMBERS_COUNT && fibonacciNumbers[index + 1] <= number);
+    }
 
-    while (left != right) {
-        size_t index = (left + right + 1) / 2;
+    const size_t BITS_IN_WORD = 64;
+    const size_t BYTE_VALUES = 1 << DIGITS_IN_BYTE;
+    const size_t MAX_CODE_WORDS_IN_BYTE = DIGITS_IN_BYTE / 2;
+
+    //Appends bits to the code, the lowest bits first
+    class BitWriter {
+    public:
+        void append(uint64_t bits, size_t count) {
+            size_t offset = size % BITS_IN_WORD;
+
+            if (offset == 0) {
+                words.push_back(0);
+            }
+
+            words.back() |= bits << offset;
+
+            if (offset + count > BITS_IN_WORD) {
+                words.push_back(bits >> (BITS_IN_WORD - offset));
+            }
 
-        if (fibonacciNumbers[index] > number) {
-            right = index - 1;
+            size += count;
+        }
+
+        vector<unsigned char> bytes() const {
+            vector<unsigned char> result(packedSize(size));
+
+            for (size_t i = 0; i < result.size(); i++) {
+                result[i] = words[i / sizeof(uint64_t)] >> (DIGITS_IN_BYTE * (i % sizeof(uint64_t)));
+            }
+
+            return result;
+        }
+
+    private:
+        vector<uint64_t> words;
+
+        size_t size = 0;
+    };
+
+    //Writes digits of number + 1 from the lowest and one more one ending the code word
+    void appendCodeWord(BitWriter &writer, uint64_t number) {
+        uint64_t bits[2] = {0, 0};
+        uint64_t rest;
+        size_t length;
+
+        //The biggest number + 1 does not fit in 64 bits, its highest digit is the biggest Fibonacci number
+        if (number == std::numeric_limits<uint64_t>::max()) {
+            size_t index = FIBONACCI_NUMBERS_COUNT - 1;
+
+            rest = number - fibonacciNumbers[index] + 1;
+            length = index + 2;
+            bits[index / BITS_IN_WORD] |= uint64_t{1} << (index % BITS_IN_WORD);
         } else {
-            left = index;
+            rest = number + 1;
+            length = biggestIndex(rest) + 2;
+        }
+
+        while (rest > 0) {
+            size_t index = biggestIndex(rest);
+            rest -= fibonacciNumbers[index];
+            bits[index / BITS_IN_WORD] |= uint64_t{1} << (index % BITS_IN_WORD);
+        }
+
+        bits[(length - 1) / BITS_IN_WORD] |= uint64_t{1} << ((length - 1) % BITS_IN_WORD);
+
+        writer.append(bits[0], std::min(length, BITS_IN_WORD));
+
+        if (length > BITS_IN_WORD) {
+            writer.append(bits[1], length - BITS_IN_WORD);
         }
     }
 
-    return left;
+    template<typename T>
+    vector<unsigned char> encode(const vector<T> &numbers) {
+        BitWriter writer;
+
+        for (T number : numbers) {
+            appendCodeWord(writer, number);
+        }
+
+        return writer.bytes();
+    }
+
+    constexpr uint64_t smallFibonacciNumber(size_t index) {
+        uint64_t previous = 1, current = 0;
+
+        for (size_t i = 0; i < index; i++) {
+            uint64_t next = previous + current;
+            previous = current;
+            current = next;
+        }
+
+        return current;
+    }
+
+    //What decoding one byte does, depending on the byte and on whether the digit before it was a one.
+    //The first digits continue a code word started before, at an offset unknown here. Digit k of them
+    //has weight F(offset + k + 2) = F(k + 1) * F(offset + 2) + F(k) * F(offset + 1), so their value
+    //is kept as sums of F(k + 1) and F(k), to be multiplied when decoding.
+    struct DecodeStep {
+        size_t ends = 0;
+        uint64_t headHigherSum = 0;
+        uint64_t headLowerSum = 0;
+        uint64_t values[MAX_CODE_WORDS_IN_BYTE] = {};
+        size_t tailDigits = 0;
+        uint64_t tailValue = 0;
+        bool lastOne = false;
+    };
+
+    constexpr array<DecodeStep, 2 * BYTE_VALUES> calculateDecodeSteps() {
+        array<DecodeStep, 2 * BYTE_VALUES> result{};
+
+        for (size_t i = 0; i < result.size(); i++) {
+            DecodeStep step;
+            bool previous = i >= BYTE_VALUES;
+            size_t position = 0;
+            uint64_t value = 0;
+
+            for (size_t k = 0; k < DIGITS_IN_BYTE; k++) {
+                bool one = (i >> k) & 1;
+
+                if (one && previous) {
+                    if (step.ends > 0) {
+                        step.values[step.ends - 1] = value;
+                    }
+
+                    step.ends++;
+                    position = 0;
+                    value = 0;
+                    previous = false;
+
+                    continue;
+                }
+
+                if (one && step.ends == 0) {
+                    step.headHigherSum += smallFibonacciNumber(position + 1);
+                    step.headLowerSum += smallFibonacciNumber(position);
+                } else if (one) {
+                    value += smallFibonacciNumber(position + 2);
+                }
+
+                position++;
+                previous = one;
+            }
+
+            step.tailDigits = position;
+            step.tailValue = value;
+            step.lastOne = previous;
+
+            result[i] = step;
+        }
+
+        return result;
+    }
+
+    constexpr array<DecodeStep, 2 * BYTE_VALUES> decodeSteps = calculateDecodeSteps();
+
+    //Values of code words are numbers + 1, so they may exceed 64 bits by one
+    using code_value_type = unsigned __int128;
+
+    const code_value_type MAX_CODE_VALUE = code_value_type{std::numeric_limits<uint64_t>::max()} + 1;
+
+    template<typename T>
+    bool pushDecoded(vector<T> &numbers, code_value_type value) {
+        if (value - 1 > std::numeric_limits<T>::max()) {
+            return false;
+        }
+
+        numbers.push_back(value - 1);
+
+        return true;
+    }
+
+    //Decodes a byte at a time; the code word being read has value and offset digits so far
+    template<typename T>
+    bool decode(const vector<unsigned char> &code, vector<T> &numbers) {
+        code_value_type value = 0;
+        size_t offset = 0;
+        bool lastOne = false;
+
+        for (unsigned char byte : code) {
+            const DecodeStep &step = decodeSteps[lastOne * BYTE_VALUES + byte];
+
+            if (step.headHigherSum != 0) {
+                if (offset >= FIBONACCI_NUMBERS_COUNT) {
+                    return false;
+                }
+
+                uint64_t lowerWeight = offset > 0 ? fibonacciNumbers[offset - 1] : 1;
+
+                //Sums of the table are below 2^8, so the products fit and only the total can be too big
+                value += code_value_type{step.headHigherSum} * fibonacciNumbers[offset] +
+                         code_value_type{step.headLowerSum} * lowerWeight;
+
+                if (value > MAX_CODE_VALUE) {
+                    return false;
+                }
+            }
+
+            if (step.ends == 0) {
+                offset += DIGITS_IN_BYTE;
+            } else {
+                if (!pushDecoded(numbers, value)) {
+                    return false;
+                }
+
+                for (size_t i = 0; i + 1 < step.ends; i++) {
+                    if (!pushDecoded(numbers, step.values[i])) {
+                        return false;
+                    }
+                }
+
+                value = step.tailValue;
+                offset = step.tailDigits;
+            }
+
+            lastOne = step.lastOne;
+        }
+
+        //Only zeros padding the last byte may follow the last code word
+        return value == 0 && offset < DIGITS_IN_BYTE;
+    }
+}
+
+namespace {
+    const size_t MIN_PARALLEL_SUM_PART = 1024;
+
+    //Threads shared by all parallel sums, so that a sum does not start threads of its own
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t size) {
+            try {
+                for (size_t i = 0; i < size; i++) {
+                    workers.emplace_back([this] {
+                        work();
+                    });
+                }
+            } catch (...) {
+                stop();
+
+                throw;
+            }
+        }
+
+        ThreadPool(const ThreadPool &that) = delete;
+
+        ThreadPool &operator=(const ThreadPool &rhs) = delete;
+
+        ~ThreadPool() {
+            stop();
+        }
+
+        //Runs task(0), ..., task(count - 1) in the threads of the pool and in the calling one,
+        //returns when all of them are done and rethrows the first exception thrown by any of them
+        void run(size_t count, const std::function<void(size_t)> &task) {
+            std::mutex mutex;
+            std::condition_variable finished;
+            size_t remaining = count;
+            std::exception_ptr error;
+
+            auto runTask = [&](size_t i) {
+                std::exception_ptr taskError;
+
+                try {
+                    task(i);
+                } catch (...) {
+                    taskError = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (taskError && !error) {
+                    error = taskError;
+                }
+
+                if (--remaining == 0) {
+                    finished.notify_one();
+                }
+            };
+
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+
+                for (size_t i = 1; i < count; i++) {
+                    tasks.emplace_back([&runTask, i] {
+                        runTask(i);
+                    });
+                }
+            }
+
+            queueChanged.notify_all();
+
+            if (count > 0) {
+                runTask(0);
+            }
+
+            //Helps with the queued tasks, so that they are done even if the pool has no threads
+            while (std::function<void()> queued = pop()) {
+                queued();
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&remaining] {
+                return remaining == 0;
+            });
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        std::mutex queueMutex;
+        std::condition_variable queueChanged;
+        std::deque<std::function<void()>> tasks;
+        bool stopping = false;
+        vector<std::thread> workers;
+
+        std::function<void()> pop() {
+            std::lock_guard<std::mutex> lock(queueMutex);
+
+            if (tasks.empty()) {
+                return nullptr;
+            }
+
+            std::function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+
+            return task;
+        }
+
+        void work() {
+            while (true) {
+                std::function<void()> task;
+
+                {
+                    std::unique_lock<std::mutex> lock(queueMutex);
+                    queueChanged.wait(lock, [this] {
+                        return stopping || !tasks.empty();
+                    });
+
+                    if (tasks.empty()) {
+                        return;
+                    }
+
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+
+                task();
+            }
+        }
+
+        //Joins all started threads, after they finish the tasks already queued
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                stopping = true;
+            }
+
+            queueChanged.notify_all();
+
+            for (std::thread &worker : workers) {
+                worker.join();
+            }
+
+            workers.clear();
+        }
+    };
+
+    //The calling thread of a sum also counts, so the pool has one thread less than the hardware
+    ThreadPool &sharedPool() {
+        static ThreadPool pool(std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1);
+
+        return pool;
+    }
+}
+
+//Finds and returns the index of the biggest Fibonacci number smaller than the given number
+size_t Fibo::biggestSmallerFibbonacciNumberIndex(fibonacci_number_type number) {
+    return biggestIndex(number);
 }
 
 fibonacci_number_type Fibo::getFibonacciNumber(size_t index) {
@@ -90,36 +598,48 @@ bool Fibo::checkStr(const char *text, size_t length) {
 Fibo::Fibo(const char *text, size_t length) {
     assert(checkStr(text, length));
 
-    for (size_t i = length; i-- > 0;) {
-        representation.push_back(text[i] == '1');
+    resize(length);
+
+    for (size_t i = 0; i < length; i++) {
+        setDigit(length - 1 - i, text[i] == '1');
     }
 
     normalize();
+
+    assert(isNormalized());
 }
 
-Fibo::Fibo() noexcept : representation{false} {}
+Fibo::Fibo() noexcept = default;
 
 Fibo::Fibo(string &text) : Fibo{text.c_str(), text.size()} {}
 
 Fibo::Fibo(const char *text) : Fibo{text, stringLength(text)} {}
 
-//arithemtic operator
+//arithemtic operators
 Fibo &Fibo::operator+=(const Fibo &rhs) {
-    if (representation.size() < rhs.length()) {
-        representation.resize(rhs.length());
+    if (this == &rhs) {
+        Fibo copy(rhs);
+
+        return *this += copy;
+    }
+
+    if (digits < rhs.digits) {
+        resize(rhs.digits);
     }
 
-    for (size_t j = 0; j < rhs.length(); j++) {
-        if (rhs.representation[j]) {
-            if (representation[j]) {
+    for (size_t w = 0; w < rhs.words.size(); w++) {
+        for (word_type ones = rhs.words[w]; ones != 0; ones &= ones - 1) {
+            size_t j = w * WORD_BITS + __builtin_ctzll(ones);
+
+            if (digit(j)) {
                 bool done = false;
 
                 if (j != 0) {
                     for (size_t i = j - 1; i + 2 > 1; i -= 2) {
-                        representation[i] = true;
+                        setDigit(i, true);
 
-                        if (i > 0 && !representation[i - 1]) {
-                            representation[i - 1] = true;
+                        if (i > 0 && !digit(i - 1)) {
+                            setDigit(i - 1, true);
                             partiallyNormalize(i > 1 ? i - 2 : i - 1);
                             done = true;
                             break;
@@ -130,144 +650,280 @@ Fibo &Fibo::operator+=(const Fibo &rhs) {
                 if (!done) {
                     normalize();
 
-                    if (representation.size() == 1) {
-                        representation.push_back(true);
+                    if (digits == 1) {
+                        pushBack(true);
                     }
-                    representation[1] = representation[0];
-                    representation[0] = !representation[0];
+                    setDigit(1, digit(0));
+                    setDigit(0, !digit(0));
 
                     normalize();
                 }
 
             } else {
-                representation[j] = true;
+                setDigit(j, true);
                 partiallyNormalize(j > 0 ? j - 1 : 0);
             }
         }
     }
 
+    assert(isNormalized());
+
     return *this;
 }
 
+Fibo operator+(const Fibo &lhs, const Fibo &rhs) {
+    Fibo result(lhs);
+    result += rhs;
+
+    return result;
+}
+
+Fibo operator+(Fibo &&lhs, const Fibo &rhs) {
+    lhs += rhs;
+
+    return std::move(lhs);
+}
+
+Fibo operator+(const Fibo &lhs, Fibo &&rhs) {
+    rhs += lhs;
+
+    return std::move(rhs);
+}
+
+Fibo operator+(Fibo &&lhs, Fibo &&rhs) {
+    if (lhs.length() < rhs.length()) {
+        rhs += lhs;
+
+        return std::move(rhs);
+    }
+
+    lhs += rhs;
+
+    return std::move(lhs);
+}
+
 //bitwise operators
 Fibo &Fibo::operator&=(const Fibo &rhs) {
-    if (representation.size() > rhs.representation.size()) {
-        representation.resize(rhs.representation.size());
+    if (digits > rhs.digits) {
+        resize(rhs.digits);
     }
 
-    for (size_t i = 0; i < representation.size(); i++) {
-        representation[i] = representation[i] & rhs.representation[i];
+    for (size_t i = 0; i < words.size(); i++) {
+        words[i] &= rhs.words[i];
     }
 
     deleteLeadingZeros();
 
+    assert(isNormalized());
+
     return *this;
 }
 
 Fibo &Fibo::operator|=(const Fibo &rhs) {
-    if (representation.size() < rhs.representation.size()) {
-        representation.resize(rhs.representation.size(), false);
+    if (digits < rhs.digits) {
+        resize(rhs.digits);
     }
 
-    for (size_t i = 0; i < rhs.representation.size(); i++) {
-        representation[i] = representation[i] | rhs.representation[i];
+    for (size_t i = 0; i < rhs.words.size(); i++) {
+        words[i] |= rhs.words[i];
     }
 
     normalize();
     deleteLeadingZeros();
 
+    assert(isNormalized());
+
     return *this;
 }
 
 Fibo &Fibo::operator^=(const Fibo &rhs) {
-    if (representation.size() < rhs.representation.size()) {
-        representation.resize(rhs.representation.size());
+    if (digits < rhs.digits) {
+        resize(rhs.digits);
     }
 
-    for (size_t i = 0; i < rhs.representation.size(); i++) {
-        representation[i] = representation[i] ^ rhs.representation[i];
+    for (size_t i = 0; i < rhs.words.size(); i++) {
+        words[i] ^= rhs.words[i];
     }
 
     normalize();
     deleteLeadingZeros();
 
+    assert(isNormalized());
+
     return *this;
 }
 
+//Moves whole words and joins parts of neighbouring words when the shift is not a multiple of their size
 Fibo &Fibo::operator<<=(size_t number) {
-    size_t oldSize = representation.size();
-    representation.resize(oldSize + number, false);
+    if (number == 0 || (digits == 1 && words[0] == 0)) {
+        return *this;
+    }
+
+    size_t wordShift = number / WORD_BITS;
+    size_t bitShift = number % WORD_BITS;
+    size_t oldSize = words.size();
 
-    for (size_t i = oldSize +number; i-->0;) {
-        representation[i] = i >= number ? representation[i - number] : false;
-        if (i > 0 && i + 1 == representation.size() && representation[i] == 0) {
-            representation.pop_back();
+    resize(digits + number);
+
+    if (bitShift == 0) {
+        std::memmove(words.data() + wordShift, words.data(), oldSize * sizeof(word_type));
+    } else {
+        for (size_t i = words.size(); i-- > wordShift;) {
+            size_t source = i - wordShift;
+            word_type carried = source > 0 ? words[source - 1] >> (WORD_BITS - bitShift) : 0;
+
+            words[i] = (words[source] << bitShift) | carried;
         }
     }
 
+    std::fill(words.begin(), words.begin() + wordShift, 0);
+
+    assert(isNormalized());
+
     return *this;
 }
 
+Fibo operator&(Fibo lhs, const Fibo &rhs) {
+    lhs &= rhs;
+
+    return lhs;
+}
+
+Fibo operator&(const Fibo &lhs, Fibo &&rhs) {
+    rhs &= lhs;
+
+    return std::move(rhs);
+}
+
+Fibo operator|(Fibo lhs, const Fibo &rhs) {
+    lhs |= rhs;
+
+    return lhs;
+}
+
+Fibo operator|(const Fibo &lhs, Fibo &&rhs) {
+    rhs |= lhs;
+
+    return std::move(rhs);
+}
+
+Fibo operator^(Fibo lhs, const Fibo &rhs) {
+    lhs ^= rhs;
+
+    return lhs;
+}
+
+Fibo operator^(const Fibo &lhs, Fibo &&rhs) {
+    rhs ^= lhs;
+
+    return std::move(rhs);
+}
+
+Fibo operator<<(Fibo lhs, size_t number) {
+    lhs <<= number;
+
+    return lhs;
+}
+
 //comparison operators
+//Normalized numbers of the same length compare as their words from the highest
 bool operator<(const Fibo &lhs, const Fibo &rhs) {
-    if (lhs.representation.size() == rhs.representation.size()) {
-        size_t i = rhs.representation.size() - 1;
+    if (lhs.digits != rhs.digits) {
+        return lhs.digits < rhs.digits;
+    }
 
-        while (i > 0 && rhs.representation[i] == lhs.representation[i]) {
-            i--;
+    for (size_t i = lhs.words.size(); i-- > 0;) {
+        if (lhs.words[i] != rhs.words[i]) {
+            return lhs.words[i] < rhs.words[i];
         }
-
-        return lhs.representation[i] < rhs.representation[i];
     }
 
-    return lhs.representation.size() < rhs.representation.size();
+    return false;
 }
 
 bool operator==(const Fibo &lhs, const Fibo &rhs) {
-    return lhs.representation == rhs.representation;
+    return lhs.digits == rhs.digits && lhs.words == rhs.words;
+}
+
+bool operator>(const Fibo &lhs, const Fibo &rhs) {
+    return rhs < lhs;
+}
+
+bool operator<=(const Fibo &lhs, const Fibo &rhs) {
+    return !(rhs < lhs);
+}
+
+bool operator>=(const Fibo &lhs, const Fibo &rhs) {
+    return !(lhs < rhs);
+}
+
+bool operator!=(const Fibo &lhs, const Fibo &rhs) {
+    return !(lhs == rhs);
 }
 
 //output operator
 ostream &operator<<(ostream &os, const Fibo &obj) {
-    for (size_t i = obj.representation.size(); i > 0; i--) {
-        os << obj.representation[i - 1];
+    string text(obj.digits, '0');
+
+    for (size_t i = 0; i < obj.digits; i++) {
+        if (obj.digit(i)) {
+            text[obj.digits - 1 - i] = '1';
+        }
     }
 
-    return os;
+    return os << text;
 }
 
 size_t Fibo::length() const {
-    return representation.size();
+    return digits;
+}
+
+//Changes the number of digits, new digits are zeros
+void Fibo::resize(size_t length) {
+    words.resize((length + WORD_BITS - 1) / WORD_BITS, 0);
+    digits = length;
+
+    if (length % WORD_BITS != 0) {
+        words.back() &= (word_type{1} << (length % WORD_BITS)) - 1;
+    }
+}
+
+void Fibo::pushBack(bool value) {
+    if (digits % WORD_BITS == 0) {
+        words.push_back(0);
+    }
+
+    setDigit(digits++, value);
 }
 
 void Fibo::partiallyNormalize(unsigned long begin) {
-    unsigned long end = representation.size();
+    unsigned long end = digits;
 
     while (begin < end) {
 
-        if (begin + 1 < end && representation[begin] && representation[begin + 1]) {
+        if (begin + 1 < end && digit(begin) && digit(begin + 1)) {
             unsigned long index = begin;
 
-            while (index < end && representation[index]) {
+            while (index < end && digit(index)) {
                 index++;
             }
 
             if (index < end) {
-                representation[index] = true;
+                setDigit(index, true);
             } else {
-                representation.push_back(true);
+                pushBack(true);
                 end++;
             }
 
             if ((index - begin) % 2 == 1) {
-                representation[begin++] = true;
-                representation[begin++] = false;
+                setDigit(begin++, true);
+                setDigit(begin++, false);
             } else {
-                representation[begin++] = false;
+                setDigit(begin++, false);
             }
 
             for (size_t i = begin; i < index; i += 2)
-                representation[i] = false;
+                setDigit(i, false);
 
             begin = index;
         } else {
@@ -276,18 +932,299 @@ void Fibo::partiallyNormalize(unsigned long begin) {
     }
 }
 
+//Checks the invariant kept by all operations: no two adjacent ones, no leading zeros
+//and no bits set after the last digit
+bool Fibo::isNormalized() const {
+    if (digits == 0 || words.size() != (digits + WORD_BITS - 1) / WORD_BITS) {
+        return false;
+    }
+
+    if ((digits % WORD_BITS != 0 && (words.back() >> (digits % WORD_BITS)) != 0) || (digits > 1 && !digit(digits - 1))) {
+        return false;
+    }
+
+    word_type previous = 0;
+
+    for (word_type word : words) {
+        if ((word & (word >> 1)) != 0 || (previous >> (WORD_BITS - 1) & word & 1) != 0) {
+            return false;
+        }
+
+        previous = word;
+    }
+
+    return true;
+}
+
 void Fibo::normalize() {
     partiallyNormalize(0);
 }
 
 void Fibo::deleteLeadingZeros() {
-    size_t newSize = representation.size();
+    size_t wordCount = words.size();
+
+    while (wordCount > 1 && words[wordCount - 1] == 0) {
+        wordCount--;
+    }
+
+    word_type highest = words[wordCount - 1];
+
+    resize(highest == 0 ? 1 : wordCount * WORD_BITS - __builtin_clzll(highest));
+}
+
+//serialization
+void Fibo::serialize(ostream &os) const {
+    vector<unsigned char> bytes;
+    pack(bytes);
+
+    os.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+}
+
+Fibo Fibo::deserialize(istream &is) {
+    size_t length;
+    vector<unsigned char> bytes;
+
+    //Digits are checked only if all of their bytes were read
+    if (!readLength(is, length) || packedSize(length) == 0 || !readBytes(is, packedSize(length), bytes)
+        || bytes.size() < packedSize(length) || !checkPacked(bytes.data(), length)) {
+        is.setstate(std::ios::failbit);
+
+        return Fibo();
+    }
+
+    return fromPacked(bytes.data(), length);
+}
+
+//Appends the number of digits and the digits, eight in a byte starting from the lowest
+void Fibo::pack(vector<unsigned char> &bytes) const {
+    size_t length = digits;
+
+    do {
+        unsigned char byte = length & ~LENGTH_CONTINUES;
+        length >>= LENGTH_BITS_IN_BYTE;
+        bytes.push_back(length > 0 ? byte | LENGTH_CONTINUES : byte);
+    } while (length > 0);
+
+    size_t begin = bytes.size();
+    size_t size = packedSize(digits);
+    bytes.resize(begin + size);
+
+    for (size_t i = 0; i < size; i++) {
+        bytes[begin + i] = words[i / sizeof(word_type)] >> (DIGITS_IN_BYTE * (i % sizeof(word_type)));
+    }
+}
+
+//Checks that the packed digits are normalized, comparing 64 digits at once:
+//no two adjacent ones, no leading zeros and no bits set after the last digit
+bool Fibo::checkPacked(const unsigned char *bytes, size_t length) {
+    if (length == 0) {
+        return false;
+    }
+
+    size_t size = packedSize(length);
+    uint64_t previous = 0;
+
+    for (size_t begin = 0; begin < size; begin += sizeof(uint64_t)) {
+        uint64_t word = loadWord(bytes + begin, std::min(sizeof(uint64_t), size - begin));
+
+        if ((word & (word >> 1)) != 0 || (previous >> 63 & word & 1) != 0) {
+            return false;
+        }
+
+        previous = word;
+    }
+
+    unsigned char last = bytes[size - 1] >> ((length - 1) % DIGITS_IN_BYTE);
+
+    return last == 1 || (length == 1 && last == 0);
+}
+
+Fibo Fibo::fromPacked(const unsigned char *bytes, size_t length) {
+    Fibo result;
+    result.resize(length);
+
+    size_t size = packedSize(length);
+
+    for (size_t i = 0; i < result.words.size(); i++) {
+        size_t begin = i * sizeof(word_type);
+        result.words[i] = loadWord(bytes + begin, std::min(sizeof(word_type), size - begin));
+    }
+
+    return result;
+}
+
+FiboWriter::FiboWriter(ostream &os) : os(os) {}
+
+FiboWriter::~FiboWriter() {
+    flush();
+}
+
+FiboWriter &FiboWriter::operator<<(const Fibo &fibo) {
+    fibo.pack(buffer);
+
+    if (buffer.size() >= BUFFER_SIZE) {
+        flush();
+    }
+
+    return *this;
+}
+
+FiboWriter &FiboWriter::operator<<(const vector<Fibo> &fibos) {
+    for (const Fibo &fibo : fibos) {
+        *this << fibo;
+    }
+
+    return *this;
+}
+
+void FiboWriter::flush() {
+    os.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+    buffer.clear();
+}
+
+FiboReader::FiboReader(istream &is) : is(is) {}
+
+bool FiboReader::read(Fibo &fibo) {
+    if (is.peek() == istream::traits_type::eof()) {
+        return false;
+    }
+
+    Fibo result = Fibo::deserialize(is);
+
+    if (!is) {
+        return false;
+    }
+
+    fibo = std::move(result);
+
+    return true;
+}
+
+vector<Fibo> FiboReader::readAll() {
+    vector<Fibo> result;
+    Fibo fibo;
 
-    while (newSize > 1 && representation[newSize - 1] == 0) {
-        newSize--;
+    while (read(fibo)) {
+        result.push_back(std::move(fibo));
     }
 
-    representation.resize(newSize);
+    return result;
+}
+
+//Adds digits of the given number to the counts of digits at every position
+void Fibo::countDigits(const Fibo &fibo, vector<size_t> &counts) {
+    if (counts.size() < fibo.digits) {
+        counts.resize(fibo.digits, 0);
+    }
+
+    for (size_t w = 0; w < fibo.words.size(); w++) {
+        for (word_type ones = fibo.words[w]; ones != 0; ones &= ones - 1) {
+            counts[w * WORD_BITS + __builtin_ctzll(ones)]++;
+        }
+    }
+}
+
+void Fibo::addDigitCounts(vector<size_t> &counts, const vector<size_t> &other) {
+    if (counts.size() < other.size()) {
+        counts.resize(other.size(), 0);
+    }
+
+    for (size_t i = 0; i < other.size(); i++) {
+        counts[i] += other[i];
+    }
+}
+
+//Returns the number whose i-th digit is counts[i], which may be any number.
+//Counts are split into binary layers, each layer has digits 0 or 1 and is normalized once,
+//so the cost is logarithmic, not linear, in the number of summed values.
+Fibo Fibo::fromDigitCounts(const vector<size_t> &counts) {
+    size_t maxCount = 0;
+
+    for (size_t count : counts) {
+        maxCount = std::max(maxCount, count);
+    }
+
+    Fibo result;
+
+    for (size_t bit = sizeof(size_t) * CHAR_BIT; bit-- > 0;) {
+        if ((maxCount >> bit) == 0) {
+            continue;
+        }
+
+        Fibo doubled(result);
+        result += doubled;
+
+        Fibo layer;
+        layer.resize(counts.size());
+
+        for (size_t i = 0; i < counts.size(); i++) {
+            layer.setDigit(i, (counts[i] >> bit) & 1);
+        }
+
+        layer.normalize();
+        layer.deleteLeadingZeros();
+
+        result += layer;
+    }
+
+    assert(result.isNormalized());
+
+    return result;
+}
+
+Fibo Fibo::sumParts(size_t size, size_t threads,
+                    const std::function<void(size_t, size_t, vector<size_t> &)> &countPart) {
+    size_t parts = std::max<size_t>(std::min(threads, size / MIN_PARALLEL_SUM_PART + 1), 1);
+    vector<vector<size_t>> counts(parts);
+
+    if (parts == 1) {
+        countPart(0, size, counts[0]);
+
+        return fromDigitCounts(counts[0]);
+    }
+
+    ThreadPool &pool = sharedPool();
+
+    pool.run(parts, [&](size_t i) {
+        countPart(size * i / parts, size * (i + 1) / parts, counts[i]);
+    });
+
+    for (size_t step = 1; step < parts; step *= 2) {
+        pool.run((parts + step - 1) / (2 * step), [&](size_t pair) {
+            addDigitCounts(counts[2 * step * pair], counts[2 * step * pair + step]);
+        });
+    }
+
+    return fromDigitCounts(counts[0]);
+}
+
+//Mixes the words of the number, which are already packed, instead of single digits
+size_t std::hash<Fibo>::operator()(const Fibo &fibo) const noexcept {
+    uint64_t result = fibo.digits;
+
+    for (Fibo::word_type word : fibo.words) {
+        result = (result ^ word) * HASH_MULTIPLIER;
+        result ^= result >> (Fibo::WORD_BITS / 2);
+    }
+
+    return result;
+}
+
+//Fibonacci code
+vector<unsigned char> fibonacciEncode(const vector<uint64_t> &numbers) {
+    return encode(numbers);
+}
+
+vector<unsigned char> fibonacciEncode(const vector<uint32_t> &numbers) {
+    return encode(numbers);
+}
+
+bool fibonacciDecode(const vector<unsigned char> &code, vector<uint64_t> &numbers) {
+    return decode(code, numbers);
+}
+
+bool fibonacciDecode(const vector<unsigned char> &code, vector<uint32_t> &numbers) {
+    return decode(code, numbers);
 }
 
 const Fibo &Zero() {
@@ -3,19 +3,19 @@
 
 #include <string>
 #include <ostream>
+#include <istream>
 #include <vector>
+#include <functional>
+#include <cstdint>
 #include <cassert>
-#include <boost/operators.hpp>
+#include <iterator>
+#include <type_traits>
 
 namespace {
     using fibonacci_number_type = unsigned long long;
 }
 
-class Fibo :
-        boost::bitwise<Fibo>,
-        boost::addable<Fibo>,
-        boost::totally_ordered<Fibo>,
-        boost::left_shiftable<Fibo, size_t> {
+class Fibo {
 public:
     // Constructors
     Fibo() noexcept;
@@ -34,24 +34,19 @@ public:
         assert(number >= 0);
 
         if (number == 0) {
-            representation.push_back(false);
-
             return;
         }
 
         if (number == 1) {
-            representation.push_back(true);
+            setDigit(0, true);
 
             return;
         }
 
         size_t biggestIndex = biggestSmallerFibbonacciNumberIndex(number);
 
-        for (size_t i = 0; i <= biggestIndex; i++) {
-            representation.push_back(false);
-        }
-
-        representation[biggestIndex] = true;
+        resize(biggestIndex + 1);
+        setDigit(biggestIndex, true);
 
         T tmpNumber = number - getFibonacciNumber(biggestIndex);
 
@@ -60,10 +55,12 @@ public:
         while (tmpNumber > 0) {
             if (getFibonacciNumber(i) <= (fibonacci_number_type) tmpNumber) {
                 tmpNumber -= getFibonacciNumber(i);
-                representation[i] = true;
+                setDigit(i, true);
             }
             i--;
         }
+
+        assert(isNormalized());
     }
 
     //destructor
@@ -74,9 +71,18 @@ public:
 
     Fibo &operator=(Fibo &&rhs) noexcept = default;
 
-    //arithmetic operator
+    //arithmetic operators
     Fibo &operator+=(const Fibo &rhs);
 
+    //temporaries passed as operands give away their storage for the result
+    friend Fibo operator+(const Fibo &lhs, const Fibo &rhs);
+
+    friend Fibo operator+(Fibo &&lhs, const Fibo &rhs);
+
+    friend Fibo operator+(const Fibo &lhs, Fibo &&rhs);
+
+    friend Fibo operator+(Fibo &&lhs, Fibo &&rhs);
+
     //bitwise operators
     Fibo &operator&=(const Fibo &rhs);
 
@@ -86,25 +92,126 @@ public:
 
     Fibo &operator<<=(size_t number);
 
+    //temporaries passed as operands give away their storage for the result
+    friend Fibo operator&(Fibo lhs, const Fibo &rhs);
+
+    friend Fibo operator&(const Fibo &lhs, Fibo &&rhs);
+
+    friend Fibo operator|(Fibo lhs, const Fibo &rhs);
+
+    friend Fibo operator|(const Fibo &lhs, Fibo &&rhs);
+
+    friend Fibo operator^(Fibo lhs, const Fibo &rhs);
+
+    friend Fibo operator^(const Fibo &lhs, Fibo &&rhs);
+
+    friend Fibo operator<<(Fibo lhs, size_t number);
+
     //comparison operators
     friend bool operator<(const Fibo &lhs, const Fibo &rhs);
 
     friend bool operator==(const Fibo &lhs, const Fibo &rhs);
 
+    friend bool operator>(const Fibo &lhs, const Fibo &rhs);
+
+    friend bool operator<=(const Fibo &lhs, const Fibo &rhs);
+
+    friend bool operator>=(const Fibo &lhs, const Fibo &rhs);
+
+    friend bool operator!=(const Fibo &lhs, const Fibo &rhs);
+
     //output operator
     friend std::ostream &operator<<(std::ostream &os, const Fibo &obj);
 
     size_t length() const;
 
+    //Writes the number in a compact binary form: length followed by digits packed into bytes
+    void serialize(std::ostream &os) const;
+
+    //Reads a number written by serialize, sets failbit of the stream if there is no valid number
+    static Fibo deserialize(std::istream &is);
+
+    //Sums the numbers in one pass: digits are counted first and normalized once at the end,
+    //instead of normalizing after every operand as a + b + c + ... does
+    template<typename ...Rest>
+    static Fibo sum(const Fibo &first, const Fibo &second, const Rest &...rest) {
+        std::vector<size_t> counts;
+
+        countDigits(first, counts);
+        countDigits(second, counts);
+        (countDigits(rest, counts), ...);
+
+        return fromDigitCounts(counts);
+    }
+
+    //Sums all numbers of the range, digits are counted first and normalized once at the end
+    template<typename Range, typename = decltype(std::begin(std::declval<const Range &>()))>
+    static Fibo sum(const Range &range) {
+        std::vector<size_t> counts;
+
+        for (const Fibo &fibo : range) {
+            countDigits(fibo, counts);
+        }
+
+        return fromDigitCounts(counts);
+    }
+
+    //Sums all numbers of the range split into parts counted by at most the given number of threads,
+    //the counts of the parts are added up in a tree. Threads are taken from a pool shared by all sums.
+    template<typename Range, typename = decltype(std::begin(std::declval<const Range &>()))>
+    static Fibo sum(const Range &range, size_t threads) {
+        auto begin = std::begin(range);
+        size_t size = std::distance(begin, std::end(range));
+
+        return sumParts(size, threads, [begin](size_t partBegin, size_t partEnd, std::vector<size_t> &counts) {
+            auto end = std::next(begin, partEnd);
+
+            for (auto it = std::next(begin, partBegin); it != end; ++it) {
+                countDigits(*it, counts);
+            }
+        });
+    }
+
 private:
-    std::vector<bool> representation;
+    friend class FiboWriter;
+
+    friend struct std::hash<Fibo>;
+
+    using word_type = uint64_t;
+
+    static const size_t WORD_BITS = 64;
+
+    //Digits from the lowest, packed into words; bits after the last digit are zeros
+    std::vector<word_type> words = {0};
+
+    size_t digits = 1;
 
     Fibo(const char *text, size_t length);
 
+    bool digit(size_t index) const {
+        return (words[index / WORD_BITS] >> (index % WORD_BITS)) & 1;
+    }
+
+    void setDigit(size_t index, bool value) {
+        word_type mask = word_type{1} << (index % WORD_BITS);
+
+        if (value) {
+            words[index / WORD_BITS] |= mask;
+        } else {
+            words[index / WORD_BITS] &= ~mask;
+        }
+    }
+
+    void resize(size_t length);
+
+    void pushBack(bool value);
+
     void partiallyNormalize(size_t begin);
 
     void normalize();
 
+    bool isNormalized() const;
+
     void deleteLeadingZeros();
 
     static size_t biggestSmallerFibbonacciNumberIndex(fibonacci_number_type number);
@@ -112,8 +219,81 @@ private:
     static fibonacci_number_type getFibonacciNumber(size_t index);
 
     static bool checkStr(const char *text, size_t length);
+
+    void pack(std::vector<unsigned char> &bytes) const;
+
+    static bool checkPacked(const unsigned char *bytes, size_t length);
+
+    static Fibo fromPacked(const unsigned char *bytes, size_t length);
+
+    static void countDigits(const Fibo &fibo, std::vector<size_t> &counts);
+
+    static void addDigitCounts(std::vector<size_t> &counts, const std::vector<size_t> &other);
+
+    static Fibo fromDigitCounts(const std::vector<size_t> &counts);
+
+    static Fibo sumParts(size_t size, size_t threads,
+                         const std::function<void(size_t, size_t, std::vector<size_t> &)> &countPart);
 };
 
+//Serializes numbers into a stream, collecting them in a buffer written out in big chunks
+class FiboWriter {
+public:
+    explicit FiboWriter(std::ostream &os);
+
+    FiboWriter(const FiboWriter &that) = delete;
+
+    FiboWriter &operator=(const FiboWriter &rhs) = delete;
+
+    ~FiboWriter();
+
+    FiboWriter &operator<<(const Fibo &fibo);
+
+    FiboWriter &operator<<(const std::vector<Fibo> &fibos);
+
+    void flush();
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    std::ostream &os;
+
+    std::vector<unsigned char> buffer;
+};
+
+//Deserializes numbers written one after another until the end of a stream
+class FiboReader {
+public:
+    explicit FiboReader(std::istream &is);
+
+    //Returns false if the stream has ended or does not hold a valid number
+    bool read(Fibo &fibo);
+
+    std::vector<Fibo> readAll();
+
+private:
+    std::istream &is;
+};
+
+namespace std {
+    template<>
+    struct hash<Fibo> {
+        size_t operator()(const Fibo &fibo) const noexcept;
+    };
+}
+
+//Fibonacci code, a self-delimiting code of integers: number n is written as the digits of n + 1
+//from the lowest, followed by one more one, so that two adjacent ones end every code word.
+//The code is padded with zeros to full bytes.
+std::vector<unsigned char> fibonacciEncode(const std::vector<uint64_t> &numbers);
+
+std::vector<unsigned char> fibonacciEncode(const std::vector<uint32_t> &numbers);
+
+//Appends decoded numbers, returns false if the code is invalid or holds a number too big for the type
+bool fibonacciDecode(const std::vector<unsigned char> &code, std::vector<uint64_t> &numbers);
+
+bool fibonacciDecode(const std::vector<unsigned char> &code, std::vector<uint32_t> &numbers);
+
 const Fibo &Zero();
 
 const Fibo &One();
@@ -0,0 +1,105 @@
+//Times construction, addition, bitwise operations, shift and comparison of Fibo numbers
+//with 10 to 10^6 digits.
+//Build: g++ -std=c++17 -O2 operations_benchmark.cc fibo.cc -o operations_benchmark
+#include "fibo.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+    const double MIN_TIME = 0.2;
+
+    //Addition is quadratic in the number of digits, so it is not timed on longer numbers
+    const size_t MAX_ADDED_DIGITS = 100000;
+
+    //Sum of the results of all operations, so that they are not optimized away
+    size_t checksum = 0;
+
+    //Normalized random digits, the highest one is a one
+    std::string randomText(std::mt19937_64 &random, size_t digits) {
+        std::string text(digits, '0');
+        text[0] = '1';
+
+        for (size_t i = 2; i < digits; i++) {
+            if (text[i - 1] == '0' && random() % 2 == 0) {
+                text[i] = '1';
+            }
+        }
+
+        return text;
+    }
+
+    //Repeats the operation for at least MIN_TIME seconds, returns the mean time of one in microseconds
+    template<typename Operation>
+    double measure(Operation operation) {
+        size_t repeats = 0;
+        double time = 0;
+        auto begin = std::chrono::steady_clock::now();
+
+        while (time < MIN_TIME) {
+            checksum += operation();
+            repeats++;
+            time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        }
+
+        return time / repeats * 1e6;
+    }
+}
+
+int main() {
+    std::mt19937_64 random(2020);
+
+    std::cout << std::setw(10) << "digits" << std::setw(10) << "string" << std::setw(10) << "+="
+              << std::setw(10) << "&" << std::setw(10) << "|" << std::setw(10) << "^"
+              << std::setw(10) << "<< 1000" << std::setw(10) << "<" << "  (microseconds)\n";
+
+    for (size_t digits = 10; digits <= 1000000; digits *= 10) {
+        std::string lhsText = randomText(random, digits), rhsText = randomText(random, digits);
+        Fibo lhs(lhsText), rhs(rhsText);
+
+        std::cout << std::setw(10) << digits;
+
+        for (double time : {
+                measure([&lhsText] {
+                    return Fibo(lhsText).length();
+                }),
+                digits > MAX_ADDED_DIGITS ? 0 : measure([&lhs, &rhs] {
+                    Fibo result(lhs);
+                    result += rhs;
+
+                    return result.length();
+                }),
+                measure([&lhs, &rhs] {
+                    return (lhs & rhs).length();
+                }),
+                measure([&lhs, &rhs] {
+                    return (lhs | rhs).length();
+                }),
+                measure([&lhs, &rhs] {
+                    return (lhs ^ rhs).length();
+                }),
+                measure([&lhs] {
+                    return (lhs << 1000).length();
+                }),
+                measure([&lhs, &rhs] {
+                    return size_t(lhs < rhs);
+                })}) {
+            if (time == 0) {
+                std::cout << std::setw(10) << '-';
+            } else {
+                std::cout << std::setw(10) << std::setprecision(4) << time;
+            }
+        }
+
+        std::cout << std::endl;
+    }
+
+    std::cout << "integer: " << measure([&random] {
+        return Fibo(random()).length();
+    }) << " microseconds\n";
+    std::cout << "checksum: " << checksum << '\n';
+}
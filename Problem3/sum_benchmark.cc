@@ -0,0 +1,59 @@
+//Times Fibo::sum over a million numbers in 1 to 32 threads against adding them one by one with +=,
+//and checks that all sums are equal.
+//Build: g++ -std=c++17 -O2 -pthread sum_benchmark.cc fibo.cc -o sum_benchmark
+#include "fibo.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+    const size_t NUMBERS = 1 << 20;
+    const size_t MAX_THREADS = 32;
+
+    template<typename F>
+    Fibo measure(const char *name, F sum) {
+        auto begin = std::chrono::steady_clock::now();
+        Fibo result = sum();
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        std::cout << name << ": " << time * 1e3 << " ms\n";
+
+        return result;
+    }
+}
+
+int main() {
+    std::mt19937_64 random(2020);
+    std::vector<Fibo> numbers;
+
+    for (size_t i = 0; i < NUMBERS; i++) {
+        numbers.emplace_back(random());
+    }
+
+    Fibo expected = measure("+=", [&numbers] {
+        Fibo result;
+
+        for (const Fibo &number : numbers) {
+            result += number;
+        }
+
+        return result;
+    });
+
+    for (size_t threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        std::string name = "sum, " + std::to_string(threads) + " threads";
+        Fibo result = measure(name.c_str(), [&numbers, threads] {
+            return Fibo::sum(numbers, threads);
+        });
+
+        if (result != expected) {
+            std::cout << "sum differs from +=\n";
+
+            return EXIT_FAILURE;
+        }
+    }
+}
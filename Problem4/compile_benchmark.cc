@@ -0,0 +1,376 @@
+// Times compilation of generated Fibin programs and measures peak memory of the compiler.
+// Every case is compiled in two variants, before and after a change, given by the sources of both.
+// Build: g++ -std=c++17 -O2 compile_benchmark.cc -o compile_benchmark
+// Run from the directory of fibin.h: ./compile_benchmark [compiler]
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Case {
+        std::string name;
+        std::string before;
+        std::string after;
+    };
+
+    struct Measurement {
+        bool compiled = false;
+        double seconds = 0;
+        double megabytes = 0;
+    };
+
+    // Compiles the source with the default limits of the compiler. The source is written to a temporary
+    // directory and removed afterwards, fibin.h is found in the current one.
+    Measurement compile(const std::string &compiler, const std::string &source) {
+        std::filesystem::path path = std::filesystem::temp_directory_path()
+                                     / ("compile_benchmark_" + std::to_string(getpid()) + ".cc");
+        std::ofstream(path) << source;
+
+        std::string command = compiler + " -std=c++17 -I. -c -o /dev/null '" + path.string() + "' > /dev/null 2>&1";
+        auto begin = std::chrono::steady_clock::now();
+        pid_t child = fork();
+
+        if (child == 0) {
+            execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+            _exit(127);
+        }
+
+        int status = 0;
+        rusage usage{};
+        Measurement result;
+
+        if (child > 0 && wait4(child, &status, 0, &usage) == child) {
+            result.compiled = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            result.megabytes = usage.ru_maxrss / 1024.0;
+        }
+
+        std::filesystem::remove(path);
+
+        return result;
+    }
+
+    std::string program(const std::string &body) {
+        return "#include \"fibin.h\"\n" + body + "\nint main() {\n}\n";
+    }
+
+    // Fibonacci numbers as computed before, by a doubly recursive template.
+    const std::string RECURSIVE_FIB = R"(
+template<typename ValueType, FibonacciIndex N>
+struct OldCalculateFib {
+    static const ValueType result = OldCalculateFib<ValueType, N - 1>::result +
+                                    OldCalculateFib<ValueType, N - 2>::result;
+};
+
+template<typename ValueType>
+struct OldCalculateFib<ValueType, 1> {
+    static const ValueType result = 1;
+};
+
+template<typename ValueType>
+struct OldCalculateFib<ValueType, 0> {
+    static const ValueType result = 0;
+};
+)";
+
+    // Array of the given fibonacci numbers of every type, calculated by the template.
+    std::string fibonacciNumbers(const std::string &calculate, const std::vector<std::string> &types,
+                                 const std::vector<unsigned long> &indices) {
+        std::string result;
+
+        for (std::size_t i = 0; i < types.size(); i++) {
+            result += "constexpr " + types[i] + " values" + std::to_string(i) + "[] = {";
+
+            for (unsigned long index : indices) {
+                result += calculate + "<" + types[i] + ", " + std::to_string(index) + ">::result, ";
+            }
+
+            result += "};\n";
+        }
+
+        return result;
+    }
+
+    Case fibonacciCase(const std::string &name, const std::vector<std::string> &types,
+                       const std::vector<unsigned long> &indices) {
+        return {name, program(RECURSIVE_FIB + fibonacciNumbers("OldCalculateFib", types, indices)),
+                program(fibonacciNumbers("details::CalculateFib", types, indices))};
+    }
+
+    // Indices from the biggest one, so that the recursive template cannot reuse smaller numbers.
+    std::vector<unsigned long> range(unsigned long count, unsigned long step) {
+        std::vector<unsigned long> result;
+
+        for (unsigned long i = count; i-- > 0;) {
+            result.push_back(i * step);
+        }
+
+        return result;
+    }
+
+    std::string variable(std::size_t index, bool distinct) {
+        return "Var(\"x" + (distinct ? std::to_string(index) : "") + "\")";
+    }
+
+    // Chain of lets, each of them incrementing the variable bound by the previous one,
+    // distinct variables are all visible in the innermost expression.
+    std::string letChain(std::size_t depth, bool distinct = false) {
+        std::string result = "Ref<" + variable(depth, distinct) + ">";
+
+        for (std::size_t i = depth; i > 0; i--) {
+            result = "Let<" + variable(i, distinct) + ", Inc1<Ref<" + variable(i - 1, distinct) + ">>, " +
+                     result + ">";
+        }
+
+        return "Let<" + variable(0, distinct) + ", Lit<Fib<0>>, " + result + ">";
+    }
+
+    std::string evaluation(const std::string &backend, const std::string &expression, const std::string &value) {
+        return "static_assert(Fibin<uint64_t>::" + backend + "<" + expression + ">() == " + value + ");";
+    }
+
+    // Evaluated by eval before and by interpret after.
+    Case backendCase(const std::string &name, const std::string &expression, const std::string &value) {
+        return {name, program(evaluation("eval", expression, value)),
+                program(evaluation("interpret", expression, value))};
+    }
+
+    std::string literal(unsigned long index) {
+        return "Lit<Fib<" + std::to_string(index) + ">>";
+    }
+
+    std::string ref(const std::string &name) {
+        return "Ref<Var(\"" + name + "\")>";
+    }
+
+    std::string let(const std::string &name, const std::string &value, const std::string &expression) {
+        return "Let<Var(\"" + name + "\"), " + value + ", " + expression + ">";
+    }
+
+    std::string increment(const std::string &name) {
+        return "Inc1<" + ref(name) + ">";
+    }
+
+    unsigned long fibonacci(unsigned long index) {
+        return index < 2 ? index : fibonacci(index - 1) + fibonacci(index - 2);
+    }
+
+    // Operations emulated by loops unrolled into nested lets of a counter c, as many times as it may be needed.
+    const std::size_t UNROLLED = 64;
+
+    // a - b, for a >= b, is c such that b + c == a.
+    std::string emulatedSub(const std::string &a, const std::string &b) {
+        std::string loop = ref("c");
+
+        for (std::size_t i = 0; i < UNROLLED; i++) {
+            loop = "If<Eq<Sum<" + ref("b") + ", " + ref("c") + ">, " + ref("a") + ">, " + ref("c") + ", " +
+                   let("c", increment("c"), loop) + ">";
+        }
+
+        return let("a", a, let("b", b, let("c", literal(0), loop)));
+    }
+
+    // a * b is a added b times to p.
+    std::string emulatedMul(const std::string &a, const std::string &b) {
+        std::string loop = ref("p");
+
+        for (std::size_t i = 0; i < UNROLLED; i++) {
+            loop = "If<Eq<" + ref("c") + ", " + ref("b") + ">, " + ref("p") + ", " +
+                   let("p", "Sum<" + ref("p") + ", " + ref("a") + ">", let("c", increment("c"), loop)) + ">";
+        }
+
+        return let("a", a, let("b", b, let("p", literal(0), let("c", literal(0), loop))));
+    }
+
+    // a < b if a + c == b for some positive c, gives 1 or 0.
+    std::string emulatedLt(const std::string &a, const std::string &b) {
+        std::string loop = literal(0);
+
+        for (std::size_t i = 0; i < UNROLLED; i++) {
+            loop = "If<Eq<Sum<" + ref("a") + ", " + ref("c") + ">, " + ref("b") + ">, " + literal(1) + ", " +
+                   let("c", increment("c"), loop) + ">";
+        }
+
+        return let("a", a, let("b", b, let("c", literal(1), loop)));
+    }
+
+    // a % m is r counted modulo m up to a.
+    std::string emulatedMod(const std::string &a, const std::string &m) {
+        std::string loop = ref("r");
+
+        for (std::size_t i = 0; i < UNROLLED; i++) {
+            loop = "If<Eq<" + ref("c") + ", " + ref("a") + ">, " + ref("r") + ", " +
+                   let("c", increment("c"), let("r", "If<Eq<" + increment("r") + ", " + ref("m") + ">, " +
+                                                     literal(0) + ", " + increment("r") + ">", loop)) + ">";
+        }
+
+        return let("a", a, let("m", m, let("r", literal(0), let("c", literal(0), loop))));
+    }
+
+    using Emulation = std::string (*)(const std::string &, const std::string &);
+
+    // The operation on all pairs of fibonacci numbers up to 55 for which it is defined,
+    // by its emulation before and by its node after.
+    Case operationCase(const std::string &name, const std::string &node, Emulation emulation,
+                       unsigned long (*operation)(unsigned long, unsigned long)) {
+        std::string before, after;
+
+        for (unsigned long i = 0; i <= 10; i++) {
+            for (unsigned long j = 0; j <= 10; j++) {
+                unsigned long a = fibonacci(i), b = fibonacci(j);
+
+                if ((node == "Sub" && a < b) || (node == "Mod" && b == 0)) {
+                    continue;
+                }
+
+                std::string value = std::to_string(operation(a, b));
+                std::string expression = node == "Lt" ? "If<Lt<" + literal(i) + ", " + literal(j) + ">, " +
+                                                        literal(1) + ", " + literal(0) + ">"
+                                                      : node + "<" + literal(i) + ", " + literal(j) + ">";
+
+                before += evaluation("eval", emulation(literal(i), literal(j)), value) + "\n";
+                after += evaluation("eval", expression, value) + "\n";
+            }
+        }
+
+        return {name, program(before), program(after)};
+    }
+
+    // Sum as defined before, recursively on the rest of its arguments.
+    const std::string RECURSIVE_SUM = R"(
+template<typename First, typename... Rest>
+struct OldSum {
+    template<typename ValueType, typename Environment>
+    using result = details::Value<
+            ValueType, static_cast<ValueType>(
+                    First::template result<ValueType, Environment>::numberValue +
+                    OldSum<Rest...>::template result<ValueType, Environment>::numberValue
+            )
+    >;
+};
+
+template<typename First, typename Second>
+struct OldSum<First, Second> {
+    template<typename ValueType, typename Environment>
+    using result = details::Value<ValueType, First::template result<ValueType, Environment>::numberValue +
+                                             Second::template result<ValueType, Environment>::numberValue>;
+};
+)";
+
+    // Sums of the given number of arguments, each of them a fibonacci number up to 55.
+    Case sumCase(const std::string &name, std::size_t sums, std::size_t arguments) {
+        std::string before, after;
+
+        for (std::size_t i = 0; i < sums; i++) {
+            std::string list;
+            unsigned long value = 0;
+
+            for (std::size_t j = 0; j < arguments; j++) {
+                list += (j == 0 ? "" : ", ") + literal((i + j) % 11);
+                value += fibonacci((i + j) % 11);
+            }
+
+            before += evaluation("eval", "OldSum<" + list + ">", std::to_string(value)) + "\n";
+            after += evaluation("eval", "Sum<" + list + ">", std::to_string(value)) + "\n";
+        }
+
+        return {name, program(RECURSIVE_SUM + before), program(after)};
+    }
+
+    // Recursive functions of n = F(index) defined once by LetRec: the sum of 1, ..., n, recursing n times,
+    // and doubly recursive fibonacci numbers, computed for every argument once thanks to memoization.
+    Case recursionCase(const std::string &name, unsigned long index) {
+        std::string sum = "LetRec<Var(\"sum\"), Lambda<Var(\"n\"), If<Eq<" + ref("n") + ", " + literal(0) + ">, " +
+                          literal(0) + ", Sum<" + ref("n") + ", Invoke<" + ref("sum") + ", Sub<" + ref("n") + ", " +
+                          literal(1) + ">>>>>, Invoke<" + ref("sum") + ", " + literal(index) + ">>";
+        std::string fib = "LetRec<Var(\"fib\"), Lambda<Var(\"n\"), If<Lt<" + ref("n") + ", " + literal(3) + ">, " +
+                          ref("n") + ", Sum<Invoke<" + ref("fib") + ", Sub<" + ref("n") + ", " + literal(1) +
+                          ">>, Invoke<" + ref("fib") + ", Sub<" + ref("n") + ", " + literal(3) + ">>>>>, Invoke<" +
+                          ref("fib") + ", " + literal(index) + ">>";
+        unsigned long n = fibonacci(index);
+        std::uint64_t previous = 1, current = 0;
+
+        for (unsigned long i = 0; i < n; i++) {
+            current += previous;
+            previous = current - previous;
+        }
+
+        std::string values[] = {std::to_string(n * (n + 1) / 2), std::to_string(current) + "u"};
+        std::string before, after;
+
+        before += evaluation("eval", sum, values[0]) + "\n" + evaluation("eval", fib, values[1]);
+        after += evaluation("interpret", sum, values[0]) + "\n" + evaluation("interpret", fib, values[1]);
+
+        return {name, program(before), program(after)};
+    }
+
+    std::vector<Case> cases() {
+        const std::vector<std::string> unsignedTypes = {"uint8_t", "uint16_t", "uint32_t", "uint64_t",
+                                                        "unsigned __int128"};
+
+        return {
+                fibonacciCase("300 Fib<N>, N < 300, uint64_t", {"uint64_t"}, range(300, 1)),
+                fibonacciCase("300 Fib<N>, N < 300, 5 unsigned types", unsignedTypes, range(300, 1)),
+                fibonacciCase("90 Fib<N>, N < 90, int64_t and __int128", {"int64_t", "__int128"}, range(90, 1)),
+                fibonacciCase("300 Fib<N>, N < 3000, uint64_t", {"uint64_t"}, range(300, 10)),
+                fibonacciCase("300 Fib<N>, N < 30000, uint64_t", {"uint64_t"}, range(300, 100)),
+                backendCase("Let chain 100 deep, eval / interpret", letChain(100), "100"),
+                backendCase("Let chain 280 deep, eval / interpret", letChain(280), "280"),
+                backendCase("Let chain 400 deep, eval / interpret", letChain(400), "400"),
+                backendCase("Let chain 800 deep, eval / interpret", letChain(800), "800"),
+                backendCase("280 distinct variables, eval / interpret", letChain(280, true), "280"),
+                backendCase("400 distinct variables, eval / interpret", letChain(400, true), "400"),
+                operationCase("Sub of 66 pairs, emulated / node", "Sub", emulatedSub, [](unsigned long a, unsigned long b) {
+                    return a - b;
+                }),
+                operationCase("Mul of 121 pairs, emulated / node", "Mul", emulatedMul, [](unsigned long a, unsigned long b) {
+                    return a * b;
+                }),
+                operationCase("Lt of 121 pairs, emulated / node", "Lt", emulatedLt, [](unsigned long a, unsigned long b) {
+                    return static_cast<unsigned long>(a < b);
+                }),
+                operationCase("Mod of 110 pairs, emulated / node", "Mod", emulatedMod, [](unsigned long a, unsigned long b) {
+                    return a % b;
+                }),
+                sumCase("20 Sums of 100 arguments, recursive / flat", 20, 100),
+                sumCase("5 Sums of 800 arguments, recursive / flat", 5, 800),
+                recursionCase("LetRec of n = 89, eval / interpret", 11),
+                recursionCase("LetRec of n = 233, eval / interpret", 13),
+                recursionCase("LetRec of n = 610, eval / interpret", 15),
+                recursionCase("LetRec of n = 1597, eval / interpret", 17),
+        };
+    }
+
+    void print(const Measurement &measurement) {
+        if (measurement.compiled) {
+            std::cout << std::setw(10) << std::fixed << std::setprecision(2) << measurement.seconds
+                      << std::setw(10) << std::setprecision(0) << measurement.megabytes;
+        } else {
+            std::cout << std::setw(20) << "fails";
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string compiler = argc > 1 ? argv[1] : "g++";
+
+    std::cout << std::left << std::setw(45) << "case" << std::right << std::setw(10) << "before s"
+              << std::setw(10) << "MB" << std::setw(10) << "after s" << std::setw(10) << "MB" << '\n';
+
+    for (const Case &benchmark : cases()) {
+        std::cout << std::left << std::setw(45) << benchmark.name << std::right << std::flush;
+        print(compile(compiler, benchmark.before));
+        print(compile(compiler, benchmark.after));
+        std::cout << std::endl;
+    }
+}
@@ -0,0 +1,33 @@
+// Pins the nesting of expressions which compile with the default limits of the compiler.
+// Every nested Let binds another variable, all of them are visible in the innermost expression.
+// Build: g++ -std=c++17 depth_test.cc -o depth_test
+#include "fibin.h"
+
+#include <cstddef>
+
+// Lets binding variables First + 1, ..., First + N, each to the previous one incremented.
+// Built by halves, so that building does not take the depth which evaluation takes.
+template<std::size_t N, VariableId First, typename Expression>
+struct Nest {
+    using type = typename Nest<N / 2, First,
+            typename Nest<N - N / 2, First + N / 2, Expression>::type>::type;
+};
+
+template<VariableId First, typename Expression>
+struct Nest<1, First, Expression> {
+    using type = Let<First + 1, Inc1<Ref<First>>, Expression>;
+};
+
+// Sum of the first and the last of N + 1 visible variables, which is N.
+template<std::size_t N>
+using Bindings = Let<1, Lit<Fib<0>>, typename Nest<N, 1, Sum<Ref<1>, Ref<N + 1>>>::type>;
+
+// Lookup and binding take the same depth, however many variables are visible,
+// so eval is limited by the nesting alone, at two levels of instantiation per Let.
+static_assert(Fibin<uint64_t>::eval<Bindings<400>>() == 400);
+
+// The interpreter takes one level per Let, for lowering.
+static_assert(Fibin<uint64_t>::interpret<Bindings<800>>() == 800);
+
+int main() {
+}
@@ -3,15 +3,21 @@
 
 #include <iostream>
 #include <cstdint>
+#include <climits>
+#include <cstddef>
+#include <array>
+#include <utility>
+#include <stdexcept>
 #include <type_traits>
 
 // Type for indices of fibonacci numbers.
 using FibonacciIndex = uint64_t;
-// Type for ids of variable names.
-using VariableId = uint32_t;
+// Type for ids of variable names, which are their hashes.
+using VariableId = uint64_t;
 
-// Base in which variable id is calculated.
-static const VariableId BASE = 37;
+// Parameters of the 64-bit FNV-1a hash.
+static const VariableId HASH_OFFSET = 14695981039346656037ULL;
+static const VariableId HASH_PRIME = 1099511628211ULL;
 
 static const VariableId INVALID_VARIABLE_SIGN = 0;
 static const VariableId INVALID_VARIABLE_ID = 0;
@@ -36,33 +42,110 @@ namespace details {
         return INVALID_VARIABLE_SIGN;
     }
 
-// Type for empty list.
-    struct EmptyList {
+// Environment is a trie indexed by digits of variable ids, so that both binding and lookup
+// instantiate the same number of templates, however many variables are visible.
+// Nested expressions still take depth of their own, so the number of visible variables is bounded
+// by the nesting which the compiler allows, see depth_test.cc.
+// Only the lowest 32 bits of ids index the trie. A leaf keeps a list of the variables whose ids
+// agree in them, compared by whole ids, so that such variables do not collide, see scope_test.cc.
+    static const std::size_t SCOPE_DIGIT_BITS = 4;
+    static const std::size_t SCOPE_FANOUT = 1 << SCOPE_DIGIT_BITS;
+    static const std::size_t SCOPE_LEVELS = 32 / SCOPE_DIGIT_BITS;
+
+// Type for the part of the trie without any bindings.
+    struct EmptyScope {
     };
 
-// Type for list.
-    template<VariableId = 0, typename First = EmptyList, typename Rest = EmptyList>
-    struct List {
-        using head = First;
-        using tail = Rest;
+// Binding of a variable followed by the other bindings in the same leaf, ended by EmptyScope.
+    template<VariableId Variable, typename Value, typename Next>
+    struct ScopeLeaf {
     };
 
-// Searching list for a given variable.
-    template<VariableId Variable, typename Environment>
-    struct FindList {
-        using result = typename FindList<Variable, typename Environment::tail>::result;
+    template<typename... Children>
+    struct ScopeNode {
     };
 
-// The search ends here if the variable was found.
-    template<VariableId Variable, typename Value, typename Tail>
-    struct FindList<Variable, List<Variable, Value, Tail>> {
-        using result = Value;
+    constexpr std::size_t scopeDigit(VariableId variable, std::size_t level) {
+        return (variable >> ((SCOPE_LEVELS - 1 - level) * SCOPE_DIGIT_BITS)) % SCOPE_FANOUT;
+    }
+
+    template<std::size_t>
+    using SkippedChild = const void *;
+
+// Only declared, picks the child after the skipped ones by deduction.
+    template<typename Indices>
+    struct SelectChild;
+
+    template<std::size_t... Skipped>
+    struct SelectChild<std::index_sequence<Skipped...>> {
+        template<typename Child>
+        static Child select(SkippedChild<Skipped>..., const Child *, ...);
     };
 
-// The search generates compilation error if the element
-// that was searched for is not in the list.
-    template<VariableId Variable>
-    struct FindList<Variable, EmptyList> {
+    template<std::size_t Index, typename... Children>
+    using Child = decltype(SelectChild<std::make_index_sequence<Index>>::select(
+            static_cast<const Children *>(nullptr)...));
+
+    template<typename Scope>
+    struct Keep {
+        using result = Scope;
+    };
+
+    template<std::size_t>
+    using EmptyChild = EmptyScope;
+
+    template<typename Leaf, VariableId Variable, typename Value>
+    struct BindLeaf {
+        using result = ScopeLeaf<Variable, Value, EmptyScope>;
+    };
+
+    template<VariableId Bound, typename BoundValue, typename Next, VariableId Variable, typename Value>
+    struct BindLeaf<ScopeLeaf<Bound, BoundValue, Next>, Variable, Value> {
+        using result = ScopeLeaf<Bound, BoundValue, typename BindLeaf<Next, Variable, Value>::result>;
+    };
+
+    template<VariableId Variable, typename BoundValue, typename Next, typename Value>
+    struct BindLeaf<ScopeLeaf<Variable, BoundValue, Next>, Variable, Value> {
+        using result = ScopeLeaf<Variable, Value, Next>;
+    };
+
+// Scope extended with a new binding, which replaces the older binding of the same variable.
+// Only the path to the leaf of the variable is rebuilt, other subtries are shared.
+    template<typename Scope, VariableId Variable, typename Value, std::size_t Level = 0,
+            typename Indices = std::make_index_sequence<SCOPE_FANOUT>>
+    struct Bind;
+
+    template<VariableId Variable, typename Value, std::size_t Level, std::size_t... Indices>
+    struct Bind<EmptyScope, Variable, Value, Level, std::index_sequence<Indices...>> {
+        using result = typename Bind<ScopeNode<EmptyChild<Indices>...>, Variable, Value, Level>::result;
+    };
+
+    template<typename... Children, VariableId Variable, typename Value, std::size_t Level, std::size_t... Indices>
+    struct Bind<ScopeNode<Children...>, Variable, Value, Level, std::index_sequence<Indices...>> {
+        using result = ScopeNode<typename std::conditional_t<Indices != scopeDigit(Variable, Level), Keep<Children>,
+                std::conditional_t<Level + 1 == SCOPE_LEVELS, BindLeaf<Children, Variable, Value>,
+                        Bind<Children, Variable, Value, Level + 1>>>::result...>;
+    };
+
+// Searching scope for a given variable, generates compilation error if it is not in the scope.
+    template<typename Scope, VariableId Variable, std::size_t Level = 0>
+    struct FindScope {
+        static_assert(!std::is_same<Scope, EmptyScope>::value, "Variable is not defined.");
+    };
+
+    template<typename... Children, VariableId Variable, std::size_t Level>
+    struct FindScope<ScopeNode<Children...>, Variable, Level> {
+        using result = typename FindScope<Child<scopeDigit(Variable, Level), Children...>, Variable, Level + 1>::result;
+    };
+
+    template<VariableId Bound, typename Value, typename Next, VariableId Variable>
+    struct FindScope<ScopeLeaf<Bound, Value, Next>, Variable, SCOPE_LEVELS> {
+        using result = typename FindScope<Next, Variable, SCOPE_LEVELS>::result;
+    };
+
+    template<VariableId Variable, typename Value, typename Next>
+    struct FindScope<ScopeLeaf<Variable, Value, Next>, Variable, SCOPE_LEVELS> {
+        using result = Value;
     };
 
 // Encapsulation for number values.
@@ -75,22 +158,150 @@ namespace details {
     struct Boolean {
     };
 
-// Calculating fibonacci numbers.
+// Checks if the type is an integer, std::is_integral and std::is_signed
+// know 128-bit integers only in GNU mode.
+    template<typename T>
+    struct IsInteger : std::is_integral<T> {
+    };
+
+    template<typename T>
+    struct IsSignedInteger : std::bool_constant<std::is_integral<T>::value && std::is_signed<T>::value> {
+    };
+
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef __int128 Int128;
+    __extension__ typedef unsigned __int128 UnsignedInt128;
+
+    template<>
+    struct IsInteger<Int128> : std::true_type {
+    };
+
+    template<>
+    struct IsInteger<UnsignedInt128> : std::true_type {
+    };
+
+    template<>
+    struct IsSignedInteger<Int128> : std::true_type {
+    };
+#endif
+
+    template<typename ValueType>
+    constexpr ValueType maxSignedValue() {
+        ValueType half = static_cast<ValueType>(ValueType(1) << (sizeof(ValueType) * CHAR_BIT - 2));
+        return static_cast<ValueType>(half - 1 + half);
+    }
+
+// Checks if some fibonacci number up to the n-th one exceeds the range of a signed integer.
+    template<typename ValueType>
+    constexpr bool fibonacciOverflows(FibonacciIndex n) {
+        if (!IsSignedInteger<ValueType>::value) {
+            return false;
+        }
+
+        ValueType previous = 0, current = 1;
+
+        for (FibonacciIndex i = 1; i < n; i++) {
+            if (current > maxSignedValue<ValueType>() - previous) {
+                return true;
+            }
+
+            ValueType next = static_cast<ValueType>(previous + current);
+            previous = current;
+            current = next;
+        }
+
+        return false;
+    }
+
+// Calculates n-th fibonacci number modulo the range of an unsigned integer in O(log n) steps,
+// using F(2k) = F(k) * (2F(k + 1) - F(k)) and F(2k + 1) = F(k)^2 + F(k + 1)^2.
+    template<typename ValueType>
+    constexpr ValueType fastDoublingFibonacci(FibonacciIndex n) {
+        // Small types would be promoted to int, which could overflow.
+        using Wide = std::common_type_t<ValueType, unsigned>;
+
+        Wide current = 0, next = 1;
+
+        for (int bit = sizeof(FibonacciIndex) * CHAR_BIT; bit-- > 0;) {
+            Wide doubled = static_cast<ValueType>(current * (2 * next - current));
+            Wide doubledNext = static_cast<ValueType>(current * current + next * next);
+
+            if ((n >> bit) & 1) {
+                current = doubledNext;
+                next = static_cast<ValueType>(doubled + doubledNext);
+            } else {
+                current = doubled;
+                next = doubledNext;
+            }
+        }
+
+        return static_cast<ValueType>(current);
+    }
+
+// Calculates n-th fibonacci number using only addition, for signed integers, which are
+// checked against overflow before, and for other literal types.
+    template<typename ValueType>
+    constexpr ValueType linearFibonacci(FibonacciIndex n) {
+        ValueType previous = ValueType(1), current = ValueType(0);
+
+        for (FibonacciIndex i = 0; i < n; i++) {
+            ValueType next = previous + current;
+            previous = current;
+            current = next;
+        }
+
+        return current;
+    }
+
+    template<typename ValueType>
+    constexpr ValueType fibonacci(FibonacciIndex n) {
+        if constexpr (IsInteger<ValueType>::value && !IsSignedInteger<ValueType>::value) {
+            return fastDoublingFibonacci<ValueType>(n);
+        } else {
+            return linearFibonacci<ValueType>(n);
+        }
+    }
+
+// Calculating fibonacci numbers, a single instantiation for each of them.
     template<typename ValueType, FibonacciIndex N>
     struct CalculateFib {
-        static const ValueType result = CalculateFib<ValueType, N - 1>::result +
-                                        CalculateFib<ValueType, N - 2>::result;
+        static_assert(!fibonacciOverflows<ValueType>(N), "Fibonacci number does not fit in ValueType.");
+
+        static constexpr ValueType result = fibonacciOverflows<ValueType>(N) ? ValueType(0) : fibonacci<ValueType>(N);
     };
 
+// Type in which arithmetic on values is done. Unsigned types shorter than int would be promoted to int,
+// which could overflow, instead of wrapping around like static_cast<ValueType> does.
     template<typename ValueType>
-    struct CalculateFib<ValueType, 1> {
-        static const ValueType result = 1;
-    };
+    using Arithmetic = std::conditional_t<IsSignedInteger<ValueType>::value,
+            ValueType, std::common_type_t<ValueType, unsigned>>;
 
     template<typename ValueType>
-    struct CalculateFib<ValueType, 0> {
-        static const ValueType result = 0;
-    };
+    constexpr ValueType add(ValueType left, ValueType right) {
+        return static_cast<ValueType>(Arithmetic<ValueType>(left) + Arithmetic<ValueType>(right));
+    }
+
+    template<typename ValueType>
+    constexpr ValueType subtract(ValueType left, ValueType right) {
+        return static_cast<ValueType>(Arithmetic<ValueType>(left) - Arithmetic<ValueType>(right));
+    }
+
+    template<typename ValueType>
+    constexpr ValueType multiply(ValueType left, ValueType right) {
+        return static_cast<ValueType>(Arithmetic<ValueType>(left) * Arithmetic<ValueType>(right));
+    }
+
+// Sum of all values, added from the last one.
+    template<typename ValueType, std::size_t Size>
+    constexpr ValueType sum(const std::array<ValueType, Size> &values) {
+        ValueType result = values[Size - 1];
+
+        for (std::size_t i = Size - 1; i > 0; i--) {
+            result = add(values[i - 1], result);
+        }
+
+        return result;
+    }
 }
 
 struct True {
@@ -116,6 +327,7 @@ struct Lit {
     using result = typename T::template result<ValueType>;
 };
 
+// Names are hashed, so they can be of any length. Letters are case insensitive.
 constexpr VariableId Var(const char *name) {
     if (name == nullptr) {
         return INVALID_VARIABLE_ID;
@@ -125,42 +337,29 @@ constexpr VariableId Var(const char *name) {
         return INVALID_VARIABLE_ID;
     }
 
-    VariableId result = 0;
-    VariableId multiplier = 1;
+    VariableId result = HASH_OFFSET;
 
     for (int i = 0; name[i] != '\0'; i++) {
-        if (i >= 6) {
-            return INVALID_VARIABLE_ID;
-        }
-
         VariableId converted = details::convert(name[i]);
         if (converted == INVALID_VARIABLE_SIGN) {
             return INVALID_VARIABLE_ID;
         }
 
-        result += converted * multiplier;
-        multiplier *= BASE;
+        result = (result ^ converted) * HASH_PRIME;
     }
 
-    return result;
+    // Valid names never get the invalid id.
+    return result == INVALID_VARIABLE_ID ? result + 1 : result;
 }
 
-template<typename First, typename... Rest>
+// Values of all arguments are added in one step, without an instantiation for each of them.
+template<typename... Arguments>
 struct Sum {
-    template<typename ValueType, typename Environment>
-    using result = details::Value<
-            ValueType, static_cast<ValueType>(
-                    First::template result<ValueType, Environment>::numberValue +
-                    Sum<Rest...>::template result<ValueType, Environment>::numberValue
-            )
-    >;
-};
+    static_assert(sizeof...(Arguments) >= 2, "Sum can't be called with less than 2 arguments.");
 
-template<typename First, typename Second> // Sum can't be called with less than 2 arguments.
-struct Sum<First, Second> {
     template<typename ValueType, typename Environment>
-    using result = details::Value<ValueType, First::template result<ValueType, Environment>::numberValue +
-                                             Second::template result<ValueType, Environment>::numberValue>;
+    using result = details::Value<ValueType, details::sum<ValueType, sizeof...(Arguments)>(
+            {Arguments::template result<ValueType, Environment>::numberValue...})>;
 };
 
 template<typename ToIncrement>
@@ -183,12 +382,53 @@ struct Eq {
             Right::template result<ValueType, Environment>::numberValue>;
 };
 
+template<typename Left, typename Right>
+struct Sub {
+    template<typename ValueType, typename Environment>
+    using result = details::Value<ValueType, details::subtract<ValueType>(
+            Left::template result<ValueType, Environment>::numberValue,
+            Right::template result<ValueType, Environment>::numberValue)>;
+};
+
+template<typename Left, typename Right>
+struct Mul {
+    template<typename ValueType, typename Environment>
+    using result = details::Value<ValueType, details::multiply<ValueType>(
+            Left::template result<ValueType, Environment>::numberValue,
+            Right::template result<ValueType, Environment>::numberValue)>;
+};
+
+// Remainder of division as by operator %, modulo zero makes the compilation fail.
+template<typename Left, typename Right>
+struct Mod {
+    template<typename ValueType, typename Environment>
+    using result = details::Value<ValueType, static_cast<ValueType>(
+            Left::template result<ValueType, Environment>::numberValue %
+            Right::template result<ValueType, Environment>::numberValue)>;
+};
+
+template<typename Left, typename Right>
+struct Lt {
+    template<typename ValueType, typename Environment>
+    using result = details::Boolean<
+            (Left::template result<ValueType, Environment>::numberValue <
+             Right::template result<ValueType, Environment>::numberValue)>;
+};
+
+template<typename Left, typename Right>
+struct Le {
+    template<typename ValueType, typename Environment>
+    using result = details::Boolean<
+            Left::template result<ValueType, Environment>::numberValue <=
+            Right::template result<ValueType, Environment>::numberValue>;
+};
+
 template<VariableId Variable>
 struct Ref {
     static_assert(Variable != INVALID_VARIABLE_ID);
 
     template<typename ValueType, typename Environment>
-    using result = typename details::FindList<Variable, Environment>::result;
+    using result = typename details::FindScope<Environment, Variable>::result;
 };
 
 template<typename Condition, typename Then, typename Else>
@@ -214,9 +454,16 @@ template<VariableId Variable, typename Value, typename Expression>
 struct Let {
     static_assert(Variable != INVALID_VARIABLE_ID);
 
+    // Evaluated in a class, which is instantiated once, as the compiler substitutes
+    // nested alias templates anew every time they are used.
+    template<typename ValueType, typename Environment>
+    struct Evaluate {
+        using result = typename Expression::template result<ValueType, typename details::Bind<Environment,
+                Variable, typename Value::template result<ValueType, Environment>>::result>;
+    };
+
     template<typename ValueType, typename Environment>
-    using result = typename Expression::template result<ValueType, details::List<Variable,
-            typename Value::template result<ValueType, Environment>, Environment>>;
+    using result = typename Evaluate<ValueType, Environment>::result;
 };
 
 template<VariableId Variable, typename Body>
@@ -226,7 +473,13 @@ struct Lambda {
     template<typename ValueType, typename Environment>
     struct result {
         template<typename Param>
-        using invoke = typename Body::template result<ValueType, details::List<Variable, Param, Environment>>;
+        struct Call {
+            using result = typename Body::template result<ValueType,
+                    typename details::Bind<Environment, Variable, Param>::result>;
+        };
+
+        template<typename Param>
+        using invoke = typename Call<Param>::result;
     };
 };
 
@@ -237,19 +490,1275 @@ struct Invoke {
             Environment>::template invoke<typename Param::template result<ValueType, Environment>>;
 };
 
+// Recursive function: in the body of the lambda, Variable refers to the function itself.
+template<VariableId Variable, typename Fun>
+struct Fix {
+    static_assert(!std::is_same<Fun, Fun>::value, "Fix can only be applied to a Lambda.");
+};
+
+template<VariableId Variable, VariableId Param, typename Body>
+struct Fix<Variable, Lambda<Param, Body>> {
+    static_assert(Variable != INVALID_VARIABLE_ID);
+    static_assert(Param != INVALID_VARIABLE_ID);
+
+    // Every invocation with the same argument is the same instantiation of Call,
+    // so recursive calls repeated with equal arguments are evaluated once.
+    template<typename ValueType, typename Environment>
+    struct result {
+        using Self = result;
+
+        template<typename Argument>
+        struct Call {
+            using result = typename Body::template result<ValueType, typename details::Bind<
+                    typename details::Bind<Environment, Variable, Self>::result, Param, Argument>::result>;
+        };
+
+        template<typename Argument>
+        using invoke = typename Call<Argument>::result;
+    };
+};
+
+template<VariableId Variable, typename Fun, typename Expression>
+struct LetRec {
+    template<typename ValueType, typename Environment>
+    using result = typename Let<Variable, Fix<Variable, Fun>, Expression>::template result<ValueType, Environment>;
+};
+
+namespace details {
+// Constexpr backend: the expression type is lowered once into an array of nodes
+// and evaluated by a constexpr loop with explicit stacks, so that no templates
+// are instantiated per environment. Lowering instantiates one template for each node,
+// nested as deep as the expression is, so it meets the same depth limit as eval does.
+    enum class NodeKind {
+        Number, Boolean, Sum, Sub, Mul, Mod, Eq, Lt, Le, Ref, If, Let, Lambda, Invoke, Fix
+    };
+
+// Nodes are stored in postorder: children of a node are the subtrees just before it.
+    template<typename ValueType>
+    struct Node {
+        NodeKind kind = NodeKind::Number;
+        ValueType number = 0;
+        bool boolean = false;
+        VariableId variable = 0;
+        std::size_t size = 1;
+        std::size_t children = 0;
+    };
+
+    template<typename... Expressions>
+    struct Children {
+    };
+
+// Node of an expression and the expressions of its children.
+    template<typename ValueType, typename Expression>
+    struct Describe {
+        static_assert(!std::is_same<Expression, Expression>::value, "Not a Fibin expression.");
+    };
+
+// Nodes of compound expressions are kept in classes named by the kind of the node only. The compiler
+// mangles names of all classes with static members, which takes long for nested expressions.
+    template<typename ValueType, NodeKind Kind, VariableId Variable = 0>
+    struct DescribeNode {
+        static constexpr Node<ValueType> node = {Kind, 0, false, Variable};
+    };
+
+    template<typename ValueType, FibonacciIndex N>
+    struct Describe<ValueType, Lit<Fib<N>>> {
+        static constexpr Node<ValueType> node = {NodeKind::Number, CalculateFib<ValueType, N>::result};
+        using children = Children<>;
+    };
+
+    template<typename ValueType>
+    struct Describe<ValueType, Lit<True>> {
+        static constexpr Node<ValueType> node = {NodeKind::Boolean, 0, true};
+        using children = Children<>;
+    };
+
+    template<typename ValueType>
+    struct Describe<ValueType, Lit<False>> {
+        static constexpr Node<ValueType> node = {NodeKind::Boolean, 0, false};
+        using children = Children<>;
+    };
+
+    template<typename ValueType, typename First, typename Second>
+    struct Describe<ValueType, Sum<First, Second>> : DescribeNode<ValueType, NodeKind::Sum> {
+        using children = Children<First, Second>;
+    };
+
+// Added from the last argument, so nested sums keep the order of additions.
+    template<typename ValueType, typename First, typename Second, typename Third, typename... Rest>
+    struct Describe<ValueType, Sum<First, Second, Third, Rest...>> : DescribeNode<ValueType, NodeKind::Sum> {
+        using children = Children<First, Sum<Second, Third, Rest...>>;
+    };
+
+    template<typename ValueType, typename ToIncrement>
+    struct Describe<ValueType, Inc1<ToIncrement>> : Describe<ValueType, Sum<ToIncrement, Lit<Fib<1>>>> {
+    };
+
+    template<typename ValueType, typename ToIncrement>
+    struct Describe<ValueType, Inc10<ToIncrement>> : Describe<ValueType, Sum<ToIncrement, Lit<Fib<10>>>> {
+    };
+
+    template<typename ValueType, NodeKind Kind, typename Left, typename Right>
+    struct DescribeBinary : DescribeNode<ValueType, Kind> {
+        using children = Children<Left, Right>;
+    };
+
+    template<typename ValueType, typename Left, typename Right>
+    struct Describe<ValueType, Eq<Left, Right>> : DescribeBinary<ValueType, NodeKind::Eq, Left, Right> {
+    };
+
+    template<typename ValueType, typename Left, typename Right>
+    struct Describe<ValueType, Sub<Left, Right>> : DescribeBinary<ValueType, NodeKind::Sub, Left, Right> {
+    };
+
+    template<typename ValueType, typename Left, typename Right>
+    struct Describe<ValueType, Mul<Left, Right>> : DescribeBinary<ValueType, NodeKind::Mul, Left, Right> {
+    };
+
+    template<typename ValueType, typename Left, typename Right>
+    struct Describe<ValueType, Mod<Left, Right>> : DescribeBinary<ValueType, NodeKind::Mod, Left, Right> {
+    };
+
+    template<typename ValueType, typename Left, typename Right>
+    struct Describe<ValueType, Lt<Left, Right>> : DescribeBinary<ValueType, NodeKind::Lt, Left, Right> {
+    };
+
+    template<typename ValueType, typename Left, typename Right>
+    struct Describe<ValueType, Le<Left, Right>> : DescribeBinary<ValueType, NodeKind::Le, Left, Right> {
+    };
+
+    template<typename ValueType, VariableId Variable>
+    struct Describe<ValueType, Ref<Variable>> {
+        static constexpr Node<ValueType> node = {NodeKind::Ref, 0, false, Variable};
+        using children = Children<>;
+    };
+
+    template<typename ValueType, typename Condition, typename Then, typename Else>
+    struct Describe<ValueType, If<Condition, Then, Else>> : DescribeNode<ValueType, NodeKind::If> {
+        using children = Children<Condition, Then, Else>;
+    };
+
+    template<typename ValueType, VariableId Variable, typename Value, typename Expression>
+    struct Describe<ValueType, Let<Variable, Value, Expression>> : DescribeNode<ValueType, NodeKind::Let, Variable> {
+        using children = Children<Value, Expression>;
+    };
+
+    template<typename ValueType, VariableId Variable, typename Body>
+    struct Describe<ValueType, Lambda<Variable, Body>> : DescribeNode<ValueType, NodeKind::Lambda, Variable> {
+        using children = Children<Body>;
+    };
+
+    template<typename ValueType, typename Fun, typename Param>
+    struct Describe<ValueType, Invoke<Fun, Param>> : DescribeNode<ValueType, NodeKind::Invoke> {
+        using children = Children<Fun, Param>;
+    };
+
+    template<typename ValueType, VariableId Variable, typename Fun>
+    struct Describe<ValueType, Fix<Variable, Fun>> {
+        static_assert(!std::is_same<Fun, Fun>::value, "Fix can only be applied to a Lambda.");
+    };
+
+// The only child of a fix node is a lambda.
+    template<typename ValueType, VariableId Variable, VariableId Param, typename Body>
+    struct Describe<ValueType, Fix<Variable, Lambda<Param, Body>>> : DescribeNode<ValueType, NodeKind::Fix, Variable> {
+        using children = Children<Lambda<Param, Body>>;
+    };
+
+    template<typename ValueType, VariableId Variable, typename Fun, typename Expression>
+    struct Describe<ValueType, LetRec<Variable, Fun, Expression>>
+            : Describe<ValueType, Let<Variable, Fix<Variable, Fun>, Expression>> {
+    };
+
+    static const std::size_t MAX_CHILDREN = 3;
+
+// Node linked to the nodes of its children, each of them is stored once,
+// however many times its expression occurs.
+    template<typename ValueType>
+    struct LinkedNode {
+        Node<ValueType> node;
+        const LinkedNode *children[MAX_CHILDREN] = {};
+    };
+
+    template<typename ValueType>
+    constexpr Node<ValueType> sized(Node<ValueType> node, std::size_t size, std::size_t children) {
+        node.size = size;
+        node.children = children;
+
+        return node;
+    }
+
+    template<typename ValueType, typename Expression, typename = typename Describe<ValueType, Expression>::children>
+    struct Lower;
+
+    template<typename ValueType, typename Expression, typename... ChildExpressions>
+    struct Lower<ValueType, Expression, Children<ChildExpressions...>> {
+        static_assert(sizeof...(ChildExpressions) <= MAX_CHILDREN);
+
+        static constexpr LinkedNode<ValueType> linked = {
+                sized(Describe<ValueType, Expression>::node,
+                      1 + (Lower<ValueType, ChildExpressions>::linked.node.size + ... + 0),
+                      sizeof...(ChildExpressions)), {&Lower<ValueType, ChildExpressions>::linked...}};
+    };
+
+// Nodes in postorder, copied by a loop with an explicit stack, as the subtrees are shared.
+    template<typename ValueType, std::size_t Size>
+    constexpr std::array<Node<ValueType>, Size> flatten(const LinkedNode<ValueType> &root) {
+        struct Visit {
+            const LinkedNode<ValueType> *linked = nullptr;
+            std::size_t visited = 0;
+        };
+
+        std::array<Node<ValueType>, Size> nodes{};
+        std::array<Visit, Size> stack{};
+        std::size_t position = 0;
+        std::size_t depth = 0;
+
+        stack[depth++] = {&root, 0};
+
+        while (depth > 0) {
+            Visit &visit = stack[depth - 1];
+
+            if (visit.visited < visit.linked->node.children) {
+                const LinkedNode<ValueType> *child = visit.linked->children[visit.visited++];
+                stack[depth++] = {child, 0};
+            } else {
+                nodes[position++] = visit.linked->node;
+                depth--;
+            }
+        }
+
+        return nodes;
+    }
+
+    template<typename ValueType, typename Expression>
+    struct Flatten {
+        static constexpr std::size_t size = Lower<ValueType, Expression>::linked.node.size;
+        static constexpr std::array<Node<ValueType>, size> nodes = flatten<ValueType, size>(
+                Lower<ValueType, Expression>::linked);
+    };
+// Position of the index-th child of the node.
+    template<typename ValueType, std::size_t Size>
+    constexpr std::size_t childNode(const std::array<Node<ValueType>, Size> &nodes, std::size_t node,
+                                    std::size_t index) {
+        std::size_t result = node - 1;
+
+        for (std::size_t i = index + 1; i < nodes[node].children; i++) {
+            result -= nodes[result].size;
+        }
+
+        return result;
+    }
+
+    enum class ResultKind {
+        Number, Boolean, Closure
+    };
+
+    template<typename ValueType>
+    struct Result {
+        ResultKind kind = ResultKind::Number;
+        ValueType number = 0;
+        bool boolean = false;
+        // Lambda node and environment of a closure.
+        std::size_t lambda = 0;
+        std::size_t environment = 0;
+    };
+
+// Environments are linked lists of bindings stored in one array,
+// an environment is the index of its newest binding, 0 is the empty one.
+    template<typename ValueType>
+    struct Binding {
+        VariableId variable = 0;
+        Result<ValueType> value;
+        std::size_t parent = 0;
+        // Distinguishes bindings stored in the same place of the array one after another.
+        std::size_t serial = 0;
+    };
+
+// Result of invoking a recursive function with an argument. Closures are valid as long as
+// their environments have the serials they had when they were remembered.
+    template<typename ValueType>
+    struct Memo {
+        bool used = false;
+        Result<ValueType> function;
+        Result<ValueType> argument;
+        Result<ValueType> result;
+        std::size_t functionSerial = 0;
+        std::size_t argumentSerial = 0;
+        std::size_t resultSerial = 0;
+    };
+
+// Value of an expression, unless its evaluation did not fit in the capacity of the interpreter.
+    template<typename ValueType>
+    struct Evaluation {
+        bool fits = false;
+        ValueType value = 0;
+    };
+
+// Node being evaluated, stage counts its children evaluated so far.
+    struct Frame {
+        std::size_t node = 0;
+        std::size_t environment = 0;
+        std::size_t stage = 0;
+        std::size_t bindings = 0;
+    };
+
+    template<typename ValueType, std::size_t Size, std::size_t Capacity>
+    class Interpreter {
+    public:
+        constexpr explicit Interpreter(const std::array<Node<ValueType>, Size> &nodes) : nodes(nodes) {
+        }
+
+        constexpr Evaluation<ValueType> run() {
+            pushFrame(Size - 1, 0);
+
+            while (framesCount > 0 && !exceeded) {
+                step();
+            }
+
+            if (exceeded) {
+                return {};
+            }
+
+            return {true, number(popValue())};
+        }
+
+    private:
+        std::array<Node<ValueType>, Size> nodes;
+        std::array<Binding<ValueType>, Capacity> bindings{};
+        std::array<Result<ValueType>, Capacity> values{};
+        std::array<Frame, Capacity> frames{};
+        // Hash table with open addressing, probed from the slot given by the hash of the function and the argument.
+        std::array<Memo<ValueType>, Capacity> memos{};
+        std::size_t bindingsCount = 1;
+        std::size_t valuesCount = 0;
+        std::size_t framesCount = 0;
+        std::size_t nextSerial = 1;
+        // Set when some stack is full, which stops the evaluation.
+        bool exceeded = false;
+
+        constexpr void step() {
+            Frame &frame = frames[framesCount - 1];
+            const Node<ValueType> &node = nodes[frame.node];
+
+            switch (node.kind) {
+                case NodeKind::Number:
+                    finish({ResultKind::Number, node.number});
+                    break;
+                case NodeKind::Boolean:
+                    finish({ResultKind::Boolean, 0, node.boolean});
+                    break;
+                case NodeKind::Ref:
+                    finish(lookup(frame.environment, node.variable));
+                    break;
+                case NodeKind::Lambda:
+                    finish({ResultKind::Closure, 0, false, frame.node, frame.environment});
+                    break;
+                case NodeKind::Fix: {
+                    // The closure is made in an environment binding the variable to the closure itself.
+                    std::size_t environment = bind(node.variable, {}, frame.environment);
+                    bindings[environment].value = {ResultKind::Closure, 0, false, frame.node - 1, environment};
+                    finish(bindings[environment].value);
+                    break;
+                }
+                case NodeKind::Sum:
+                    if (frame.stage < node.children) {
+                        evaluateChild(frame, frame.stage);
+                    } else {
+                        // Added from the last one, like Sum does.
+                        ValueType sum = number(values[valuesCount - 1]);
+
+                        for (std::size_t i = 2; i <= node.children; i++) {
+                            sum = add(number(values[valuesCount - i]), sum);
+                        }
+
+                        valuesCount -= node.children;
+                        finish({ResultKind::Number, sum});
+                    }
+                    break;
+                case NodeKind::Sub:
+                case NodeKind::Mul:
+                case NodeKind::Mod:
+                case NodeKind::Eq:
+                case NodeKind::Lt:
+                case NodeKind::Le:
+                    if (frame.stage < 2) {
+                        evaluateChild(frame, frame.stage);
+                    } else {
+                        ValueType right = number(popValue());
+                        ValueType left = number(popValue());
+                        finish(binary(node.kind, left, right));
+                    }
+                    break;
+                case NodeKind::If:
+                    if (frame.stage == 0) {
+                        evaluateChild(frame, 0);
+                    } else {
+                        // The chosen branch takes the place of the whole expression.
+                        std::size_t branch = child(frame.node, boolean(popValue()) ? 1 : 2);
+                        std::size_t environment = frame.environment;
+                        framesCount--;
+                        pushFrame(branch, environment);
+                    }
+                    break;
+                case NodeKind::Let:
+                    if (frame.stage == 0) {
+                        frame.bindings = bindingsCount;
+                        evaluateChild(frame, 0);
+                    } else if (frame.stage == 1) {
+                        std::size_t environment = bind(node.variable, popValue(), frame.environment);
+                        frame.stage++;
+                        pushFrame(child(frame.node, 1), environment);
+                    } else {
+                        finishScope(frame.bindings);
+                    }
+                    break;
+                case NodeKind::Invoke:
+                    if (frame.stage < 2) {
+                        if (frame.stage == 0) {
+                            frame.bindings = bindingsCount;
+                        }
+                        evaluateChild(frame, frame.stage);
+                    } else if (frame.stage == 2) {
+                        // The function and the parameter stay on the stack until the result is remembered.
+                        const Result<ValueType> function = values[valuesCount - 2];
+                        const Result<ValueType> parameter = values[valuesCount - 1];
+
+                        if (function.kind != ResultKind::Closure) {
+                            throw std::logic_error("Fibin: invoked value is not a function.");
+                        }
+
+                        frame.stage++;
+
+                        if (recursive(function)) {
+                            std::size_t memo = findMemo(function, parameter);
+
+                            if (memo != Capacity) {
+                                pushValue(memos[memo].result);
+                                break;
+                            }
+                        }
+
+                        std::size_t environment = bind(nodes[function.lambda].variable, parameter,
+                                                       function.environment);
+                        pushFrame(function.lambda - 1, environment);
+                    } else {
+                        Result<ValueType> result = popValue();
+                        Result<ValueType> parameter = popValue();
+                        Result<ValueType> function = popValue();
+
+                        if (recursive(function)) {
+                            remember(function, parameter, result);
+                        }
+
+                        pushValue(result);
+                        finishScope(frame.bindings);
+                    }
+                    break;
+            }
+        }
+
+        constexpr std::size_t child(std::size_t node, std::size_t index) const {
+            return childNode(nodes, node, index);
+        }
+
+        static constexpr Result<ValueType> binary(NodeKind kind, ValueType left, ValueType right) {
+            switch (kind) {
+                case NodeKind::Sub:
+                    return {ResultKind::Number, subtract(left, right)};
+                case NodeKind::Mul:
+                    return {ResultKind::Number, multiply(left, right)};
+                case NodeKind::Mod:
+                    if (right == ValueType(0)) {
+                        throw std::domain_error("Fibin: modulo zero.");
+                    }
+
+                    return {ResultKind::Number, static_cast<ValueType>(left % right)};
+                case NodeKind::Lt:
+                    return {ResultKind::Boolean, 0, left < right};
+                case NodeKind::Le:
+                    return {ResultKind::Boolean, 0, left <= right};
+                default:
+                    return {ResultKind::Boolean, 0, left == right};
+            }
+        }
+
+        constexpr void evaluateChild(Frame &frame, std::size_t index) {
+            frame.stage++;
+            pushFrame(child(frame.node, index), frame.environment);
+        }
+
+        constexpr void finish(const Result<ValueType> &result) {
+            framesCount--;
+            pushValue(result);
+        }
+
+        // Bindings made in a scope can be dropped unless a closure returned from it uses them.
+        constexpr void finishScope(std::size_t bindingsBefore) {
+            Result<ValueType> result = popValue();
+
+            if (result.kind != ResultKind::Closure) {
+                bindingsCount = bindingsBefore;
+            }
+
+            finish(result);
+        }
+
+        constexpr std::size_t bind(VariableId variable, const Result<ValueType> &value, std::size_t environment) {
+            if (bindingsCount == Capacity) {
+                exceeded = true;
+                return 0;
+            }
+
+            bindings[bindingsCount] = {variable, value, environment, nextSerial++};
+
+            return bindingsCount++;
+        }
+
+        // Closures of lambdas given to Fix.
+        constexpr bool recursive(const Result<ValueType> &function) const {
+            return function.lambda + 1 < Size && nodes[function.lambda + 1].kind == NodeKind::Fix;
+        }
+
+        constexpr std::size_t serial(const Result<ValueType> &value) const {
+            return value.kind == ResultKind::Closure ? bindings[value.environment].serial : 0;
+        }
+
+        constexpr bool valid(const Result<ValueType> &value, std::size_t valueSerial) const {
+            return value.kind != ResultKind::Closure ||
+                   (value.environment < bindingsCount && bindings[value.environment].serial == valueSerial);
+        }
+
+        static constexpr bool same(const Result<ValueType> &left, const Result<ValueType> &right) {
+            if (left.kind != right.kind) {
+                return false;
+            }
+
+            switch (left.kind) {
+                case ResultKind::Number:
+                    return left.number == right.number;
+                case ResultKind::Boolean:
+                    return left.boolean == right.boolean;
+                default:
+                    return left.lambda == right.lambda && left.environment == right.environment;
+            }
+        }
+
+        static constexpr std::size_t MEMO_PROBES = 8;
+
+        static constexpr std::uint64_t hash(const Result<ValueType> &value) {
+            switch (value.kind) {
+                case ResultKind::Number:
+                    return static_cast<std::uint64_t>(value.number);
+                case ResultKind::Boolean:
+                    return value.boolean;
+                default:
+                    return value.lambda * 31 + value.environment;
+            }
+        }
+
+        static constexpr std::size_t memoSlot(const Result<ValueType> &function, const Result<ValueType> &argument) {
+            std::uint64_t value = (hash(function) * 31 + hash(argument)) * 0x9e3779b97f4a7c15u;
+
+            return static_cast<std::size_t>((value ^ (value >> 32)) % Capacity);
+        }
+
+        // Results of closures whose environments were dropped are stale, their slots may be reused.
+        constexpr bool fresh(const Memo<ValueType> &memo) const {
+            return valid(memo.function, memo.functionSerial) && valid(memo.argument, memo.argumentSerial) &&
+                   valid(memo.result, memo.resultSerial);
+        }
+
+        // Index of the remembered result, Capacity if there is none.
+        constexpr std::size_t findMemo(const Result<ValueType> &function, const Result<ValueType> &argument) const {
+            std::size_t slot = memoSlot(function, argument);
+
+            for (std::size_t i = 0; i < MEMO_PROBES && memos[slot].used; i++, slot = (slot + 1) % Capacity) {
+                const Memo<ValueType> &memo = memos[slot];
+
+                if (same(memo.function, function) && same(memo.argument, argument) && fresh(memo) &&
+                    serial(function) == memo.functionSerial && serial(argument) == memo.argumentSerial) {
+                    return slot;
+                }
+            }
+
+            return Capacity;
+        }
+
+        // Stored in the first probed slot which is free or stale. When there is none,
+        // the result in the first probed slot is forgotten.
+        constexpr void remember(const Result<ValueType> &function, const Result<ValueType> &argument,
+                                const Result<ValueType> &result) {
+            std::size_t first = memoSlot(function, argument), slot = first;
+
+            for (std::size_t i = 0; memos[slot].used && fresh(memos[slot]); i++, slot = (slot + 1) % Capacity) {
+                if (i + 1 == MEMO_PROBES) {
+                    slot = first;
+                    break;
+                }
+            }
+
+            memos[slot] = {true, function, argument, result, serial(function), serial(argument), serial(result)};
+        }
+
+        constexpr Result<ValueType> lookup(std::size_t environment, VariableId variable) const {
+            for (; environment != 0; environment = bindings[environment].parent) {
+                if (bindings[environment].variable == variable) {
+                    return bindings[environment].value;
+                }
+            }
+
+            throw std::logic_error("Fibin: variable is not defined.");
+        }
+
+        constexpr void pushFrame(std::size_t node, std::size_t environment) {
+            if (framesCount == Capacity) {
+                exceeded = true;
+                return;
+            }
+
+            frames[framesCount++] = {node, environment};
+        }
+
+        constexpr void pushValue(const Result<ValueType> &value) {
+            if (valuesCount == Capacity) {
+                exceeded = true;
+                return;
+            }
+
+            values[valuesCount++] = value;
+        }
+
+        constexpr Result<ValueType> popValue() {
+            return values[--valuesCount];
+        }
+
+        static constexpr ValueType number(const Result<ValueType> &result) {
+            if (result.kind != ResultKind::Number) {
+                throw std::logic_error("Fibin: value is not a number.");
+            }
+
+            return result.number;
+        }
+
+        static constexpr bool boolean(const Result<ValueType> &result) {
+            if (result.kind != ResultKind::Boolean) {
+                throw std::logic_error("Fibin: value is not a boolean.");
+            }
+
+            return result.boolean;
+        }
+    };
+
+    template<typename ValueType, typename Expression, std::size_t Capacity>
+    struct Interpret {
+        static constexpr Evaluation<ValueType> evaluation = Interpreter<ValueType,
+                Flatten<ValueType, Expression>::size, Capacity>(Flatten<ValueType, Expression>::nodes).run();
+    };
+
+    static const std::size_t MIN_INTERPRETER_CAPACITY = 64;
+    static const std::size_t MAX_INTERPRETER_CAPACITY = 1 << 16;
+
+// Evaluation with the capacity doubled until it fits, which is at most twice the needed one,
+// and costs at most as much as the last evaluation does.
+    template<typename ValueType, typename Expression, std::size_t Capacity = MIN_INTERPRETER_CAPACITY>
+    struct InterpretFitting {
+        static constexpr Evaluation<ValueType> evaluation = std::conditional_t<
+                Interpret<ValueType, Expression, Capacity>::evaluation.fits || Capacity >= MAX_INTERPRETER_CAPACITY,
+                Interpret<ValueType, Expression, Capacity>,
+                InterpretFitting<ValueType, Expression, 2 * Capacity>>::evaluation;
+    };
+
+// Bytecode backend: the nodes are compiled at compile time into instructions of a register machine,
+// which evaluates them at runtime. Registers are numbered from the frame of the current function,
+// variables are resolved to registers or to values captured by closures during compilation.
+    enum class Opcode : uint8_t {
+        Constant, Move, LoadCapture, LoadSelf, Add, Subtract, Multiply, Modulo, Equal, Less, LessEqual,
+        JumpIfFalse, Jump, MakeClosure, Call, Return
+    };
+
+// Jumps keep the target in destination.
+    struct Instruction {
+        Opcode opcode = Opcode::Return;
+        uint32_t destination = 0;
+        uint32_t first = 0;
+        uint32_t second = 0;
+    };
+
+// Value copied into a closure when it is made,
+// from a register or from a value captured by the closure making it.
+    struct Capture {
+        bool fromCapture = false;
+        std::size_t index = 0;
+    };
+
+// Function 0 is the whole expression.
+    struct Function {
+        std::size_t entry = 0;
+        std::size_t registers = 0;
+        std::size_t capturesBegin = 0;
+        std::size_t capturesCount = 0;
+    };
+
+    template<typename ValueType, std::size_t Size>
+    constexpr std::size_t countNodes(const std::array<Node<ValueType>, Size> &nodes, NodeKind kind) {
+        std::size_t count = 0;
+
+        for (const Node<ValueType> &node : nodes) {
+            count += node.kind == kind;
+        }
+
+        return count;
+    }
+
+    template<typename ValueType, std::size_t Size, std::size_t MaxCaptures>
+    class Compiler {
+    public:
+        static constexpr std::size_t MAX_INSTRUCTIONS = 3 * Size + 1;
+
+        std::array<Instruction, MAX_INSTRUCTIONS> instructions{};
+        std::array<ValueType, Size> constants{};
+        std::array<Function, Size + 1> functions{};
+        std::array<Capture, MaxCaptures> captures{};
+        std::size_t instructionsCount = 0;
+        std::size_t constantsCount = 0;
+        std::size_t functionsCount = 1;
+        std::size_t capturesCount = 0;
+
+        constexpr explicit Compiler(const std::array<Node<ValueType>, Size> &nodes) : nodes(nodes) {
+            std::size_t result = allocate(1);
+            compile(Size - 1, result);
+            emit(Opcode::Return, result);
+            functions[0].registers = contexts[0].maxRegisters;
+
+            sortCaptures();
+        }
+
+    private:
+        struct ScopeVariable {
+            VariableId variable = 0;
+            std::size_t depth = 0;
+            std::size_t reg = 0;
+        };
+
+        struct Context {
+            std::size_t function = 0;
+            std::size_t registers = 0;
+            std::size_t maxRegisters = 0;
+        };
+
+        struct CaptureEntry {
+            std::size_t function = 0;
+            VariableId variable = 0;
+            Capture capture;
+        };
+
+        std::array<Node<ValueType>, Size> nodes;
+        std::array<ScopeVariable, Size> scope{};
+        std::array<Context, Size + 1> contexts{};
+        std::array<CaptureEntry, MaxCaptures> entries{};
+        std::size_t scopeCount = 0;
+        std::size_t contextsCount = 1;
+
+        constexpr void compile(std::size_t position, std::size_t destination) {
+            const Node<ValueType> &node = nodes[position];
+
+            switch (node.kind) {
+                case NodeKind::Number:
+                    constants[constantsCount] = node.number;
+                    emit(Opcode::Constant, destination, constantsCount++);
+                    break;
+                case NodeKind::Boolean:
+                    constants[constantsCount] = node.boolean ? ValueType(1) : ValueType(0);
+                    emit(Opcode::Constant, destination, constantsCount++);
+                    break;
+                case NodeKind::Sum: {
+                    std::size_t first = allocate(node.children);
+
+                    for (std::size_t i = 0; i < node.children; i++) {
+                        compile(childNode(nodes, position, i), first + i);
+                    }
+
+                    // Added from the last one, like Sum<First, Rest...> does.
+                    emit(Opcode::Add, destination, first + node.children - 2, first + node.children - 1);
+
+                    for (std::size_t i = node.children - 2; i > 0; i--) {
+                        emit(Opcode::Add, destination, first + i - 1, destination);
+                    }
+
+                    release(first);
+                    break;
+                }
+                case NodeKind::Sub:
+                case NodeKind::Mul:
+                case NodeKind::Mod:
+                case NodeKind::Eq:
+                case NodeKind::Lt:
+                case NodeKind::Le: {
+                    std::size_t first = allocate(2);
+                    compile(childNode(nodes, position, 0), first);
+                    compile(childNode(nodes, position, 1), first + 1);
+                    emit(binaryOpcode(node.kind), destination, first, first + 1);
+                    release(first);
+                    break;
+                }
+                case NodeKind::Ref:
+                    reference(node.variable, destination);
+                    break;
+                case NodeKind::If: {
+                    std::size_t condition = allocate(1);
+                    compile(childNode(nodes, position, 0), condition);
+                    release(condition);
+
+                    std::size_t jumpToElse = emit(Opcode::JumpIfFalse, 0, condition);
+                    compile(childNode(nodes, position, 1), destination);
+                    std::size_t jumpToEnd = emit(Opcode::Jump);
+                    instructions[jumpToElse].destination = static_cast<uint32_t>(instructionsCount);
+                    compile(childNode(nodes, position, 2), destination);
+                    instructions[jumpToEnd].destination = static_cast<uint32_t>(instructionsCount);
+                    break;
+                }
+                case NodeKind::Let: {
+                    std::size_t value = allocate(1);
+                    compile(childNode(nodes, position, 0), value);
+
+                    scope[scopeCount++] = {node.variable, contextsCount - 1, value};
+                    compile(childNode(nodes, position, 1), destination);
+                    scopeCount--;
+
+                    release(value);
+                    break;
+                }
+                case NodeKind::Lambda:
+                    compileLambda(position, destination, false, 0);
+                    break;
+                case NodeKind::Fix:
+                    compileLambda(position - 1, destination, true, node.variable);
+                    break;
+                case NodeKind::Invoke: {
+                    std::size_t first = allocate(2);
+                    compile(childNode(nodes, position, 0), first);
+                    compile(childNode(nodes, position, 1), first + 1);
+                    emit(Opcode::Call, destination, first, first + 1);
+                    release(first);
+                    break;
+                }
+            }
+        }
+
+        // A recursive function keeps itself in a register, from which it can be captured like any variable.
+        constexpr void compileLambda(std::size_t position, std::size_t destination, bool recursive,
+                                     VariableId self) {
+            std::size_t jumpOver = emit(Opcode::Jump);
+            std::size_t function = functionsCount++;
+            functions[function].entry = instructionsCount;
+
+            // Register 0 of a function holds its parameter.
+            contexts[contextsCount++] = {function, 1, 1};
+
+            if (recursive) {
+                std::size_t selfRegister = allocate(1);
+                emit(Opcode::LoadSelf, selfRegister);
+                scope[scopeCount++] = {self, contextsCount - 1, selfRegister};
+            }
+
+            scope[scopeCount++] = {nodes[position].variable, contextsCount - 1, 0};
+
+            std::size_t result = allocate(1);
+            compile(position - 1, result);
+            emit(Opcode::Return, result);
+
+            scopeCount -= recursive ? 2 : 1;
+            functions[function].registers = contexts[--contextsCount].maxRegisters;
+
+            instructions[jumpOver].destination = static_cast<uint32_t>(instructionsCount);
+            emit(Opcode::MakeClosure, destination, function);
+        }
+
+        static constexpr Opcode binaryOpcode(NodeKind kind) {
+            switch (kind) {
+                case NodeKind::Sub:
+                    return Opcode::Subtract;
+                case NodeKind::Mul:
+                    return Opcode::Multiply;
+                case NodeKind::Mod:
+                    return Opcode::Modulo;
+                case NodeKind::Lt:
+                    return Opcode::Less;
+                case NodeKind::Le:
+                    return Opcode::LessEqual;
+                default:
+                    return Opcode::Equal;
+            }
+        }
+
+        constexpr void reference(VariableId variable, std::size_t destination) {
+            for (std::size_t i = scopeCount; i > 0; i--) {
+                const ScopeVariable &found = scope[i - 1];
+
+                if (found.variable == variable) {
+                    if (found.depth == contextsCount - 1) {
+                        emit(Opcode::Move, destination, found.reg);
+                    } else {
+                        emit(Opcode::LoadCapture, destination, capture(contextsCount - 1, found));
+                    }
+
+                    return;
+                }
+            }
+
+            throw std::logic_error("Fibin: variable is not defined.");
+        }
+
+        // Index of the variable among values captured by the function of the context,
+        // functions between it and the one binding the variable capture it as well.
+        constexpr std::size_t capture(std::size_t depth, const ScopeVariable &variable) {
+            Function &function = functions[contexts[depth].function];
+
+            for (std::size_t i = 0, index = 0; i < capturesCount; i++) {
+                if (entries[i].function == contexts[depth].function) {
+                    if (entries[i].variable == variable.variable) {
+                        return index;
+                    }
+
+                    index++;
+                }
+            }
+
+            Capture source = {false, variable.reg};
+
+            if (variable.depth != depth - 1) {
+                source = {true, capture(depth - 1, variable)};
+            }
+
+            if (capturesCount == MaxCaptures) {
+                throw std::length_error("Fibin: too many captured variables.");
+            }
+
+            entries[capturesCount++] = {contexts[depth].function, variable.variable, source};
+
+            return function.capturesCount++;
+        }
+
+        // Groups captures by functions.
+        constexpr void sortCaptures() {
+            std::size_t position = 0;
+
+            for (std::size_t function = 0; function < functionsCount; function++) {
+                functions[function].capturesBegin = position;
+
+                for (std::size_t i = 0; i < capturesCount; i++) {
+                    if (entries[i].function == function) {
+                        captures[position++] = entries[i].capture;
+                    }
+                }
+            }
+        }
+
+        constexpr std::size_t allocate(std::size_t count) {
+            Context &context = contexts[contextsCount - 1];
+            std::size_t first = context.registers;
+
+            context.registers += count;
+            context.maxRegisters = context.registers > context.maxRegisters ? context.registers : context.maxRegisters;
+
+            return first;
+        }
+
+        constexpr void release(std::size_t first) {
+            contexts[contextsCount - 1].registers = first;
+        }
+
+        constexpr std::size_t emit(Opcode opcode, std::size_t destination = 0, std::size_t first = 0,
+                                   std::size_t second = 0) {
+            instructions[instructionsCount] = {opcode, static_cast<uint32_t>(destination),
+                                               static_cast<uint32_t>(first), static_cast<uint32_t>(second)};
+
+            return instructionsCount++;
+        }
+    };
+
+    template<typename T, std::size_t Size, std::size_t Capacity>
+    constexpr std::array<T, Size> shrink(const std::array<T, Capacity> &source) {
+        std::array<T, Size> result{};
+
+        for (std::size_t i = 0; i < Size; i++) {
+            result[i] = source[i];
+        }
+
+        return result;
+    }
+
+// Bytecode of the expression, compiled once for each of them.
+    template<typename ValueType, typename Expression>
+    struct Bytecode {
+        using Lowered = Flatten<ValueType, Expression>;
+
+        static constexpr Compiler<ValueType, Lowered::size, countNodes(Lowered::nodes, NodeKind::Ref) *
+                                                            countNodes(Lowered::nodes, NodeKind::Lambda)>
+                compiler{Lowered::nodes};
+
+        static constexpr auto instructions = shrink<Instruction, compiler.instructionsCount>(compiler.instructions);
+        static constexpr auto constants = shrink<ValueType, compiler.constantsCount>(compiler.constants);
+        static constexpr auto functions = shrink<Function, compiler.functionsCount>(compiler.functions);
+        static constexpr auto captures = shrink<Capture, compiler.capturesCount>(compiler.captures);
+    };
+}
+
+// Evaluates the expression at runtime from its bytecode. Capacity limits the number of registers,
+// calls and closures of one evaluation, storage for them is a part of the program,
+// so evaluating does not allocate.
+template<typename ValueType, typename Expression, std::size_t Capacity = 1024>
+class FibinProgram {
+public:
+    // Value of the expression.
+    ValueType run() {
+        return number(runMain());
+    }
+
+    // Value of the function given by the expression, applied to the input.
+    ValueType run(ValueType input) {
+        std::size_t function = runMain().closure;
+
+        return number(call(function, input));
+    }
+
+    // Applies the function given by the expression to all inputs, the expression is evaluated once.
+    void run(const ValueType *inputs, ValueType *outputs, std::size_t count) {
+        std::size_t function = runMain().closure;
+        std::size_t closures = closuresCount, captured = capturedCount;
+
+        for (std::size_t i = 0; i < count; i++) {
+            closuresCount = closures;
+            capturedCount = captured;
+            outputs[i] = number(call(function, inputs[i]));
+        }
+    }
+
+private:
+    using Code = details::Bytecode<ValueType, Expression>;
+
+    // Booleans are kept as numbers 0 and 1. Closure 0 is the whole expression, which is not a value,
+    // so it marks slots not holding functions.
+    struct Slot {
+        ValueType number = 0;
+        std::size_t closure = 0;
+    };
+
+    struct Closure {
+        std::size_t function = 0;
+        std::size_t captured = 0;
+    };
+
+    struct Call {
+        std::size_t address = 0;
+        std::size_t frame = 0;
+        std::size_t closure = 0;
+        std::size_t destination = 0;
+    };
+
+    std::array<Slot, Capacity> registers{};
+    std::array<Slot, Capacity> captured{};
+    std::array<Closure, Capacity> closures{};
+    std::array<Call, Capacity> calls{};
+    std::size_t capturedCount = 0;
+    std::size_t closuresCount = 0;
+    std::size_t callsCount = 0;
+
+    Slot runMain() {
+        closuresCount = 1;
+        capturedCount = 0;
+        callsCount = 0;
+        closures[0] = {0, 0};
+        reserve(0, 0);
+
+        return execute(Code::functions[0].entry, 0, 0);
+    }
+
+    Slot call(std::size_t closure, ValueType input) {
+        if (closure == 0) {
+            throw std::logic_error("Fibin: invoked value is not a function.");
+        }
+
+        const details::Function &function = Code::functions[closures[closure].function];
+        reserve(0, closures[closure].function);
+        registers[0] = {input, 0};
+
+        return execute(function.entry, 0, closure);
+    }
+
+    Slot execute(std::size_t address, std::size_t frame, std::size_t closure) {
+        for (;;) {
+            const details::Instruction &instruction = Code::instructions[address++];
+            Slot *frameRegisters = registers.data() + frame;
+
+            switch (instruction.opcode) {
+                case details::Opcode::Constant:
+                    frameRegisters[instruction.destination] = {Code::constants[instruction.first], 0};
+                    break;
+                case details::Opcode::Move:
+                    frameRegisters[instruction.destination] = frameRegisters[instruction.first];
+                    break;
+                case details::Opcode::LoadCapture:
+                    frameRegisters[instruction.destination] = captured[closures[closure].captured + instruction.first];
+                    break;
+                case details::Opcode::LoadSelf:
+                    frameRegisters[instruction.destination] = {0, closure};
+                    break;
+                case details::Opcode::Add:
+                    frameRegisters[instruction.destination] = {details::add(
+                            frameRegisters[instruction.first].number, frameRegisters[instruction.second].number), 0};
+                    break;
+                case details::Opcode::Subtract:
+                    frameRegisters[instruction.destination] = {details::subtract(
+                            frameRegisters[instruction.first].number, frameRegisters[instruction.second].number), 0};
+                    break;
+                case details::Opcode::Multiply:
+                    frameRegisters[instruction.destination] = {details::multiply(
+                            frameRegisters[instruction.first].number, frameRegisters[instruction.second].number), 0};
+                    break;
+                case details::Opcode::Modulo:
+                    if (frameRegisters[instruction.second].number == ValueType(0)) {
+                        throw std::domain_error("Fibin: modulo zero.");
+                    }
+
+                    frameRegisters[instruction.destination] = {static_cast<ValueType>(
+                            frameRegisters[instruction.first].number % frameRegisters[instruction.second].number), 0};
+                    break;
+                case details::Opcode::Equal:
+                    frameRegisters[instruction.destination] = {
+                            truth(frameRegisters[instruction.first].number == frameRegisters[instruction.second].number),
+                            0};
+                    break;
+                case details::Opcode::Less:
+                    frameRegisters[instruction.destination] = {
+                            truth(frameRegisters[instruction.first].number < frameRegisters[instruction.second].number),
+                            0};
+                    break;
+                case details::Opcode::LessEqual:
+                    frameRegisters[instruction.destination] = {
+                            truth(frameRegisters[instruction.first].number <= frameRegisters[instruction.second].number),
+                            0};
+                    break;
+                case details::Opcode::JumpIfFalse:
+                    if (frameRegisters[instruction.first].number == ValueType(0)) {
+                        address = instruction.destination;
+                    }
+                    break;
+                case details::Opcode::Jump:
+                    address = instruction.destination;
+                    break;
+                case details::Opcode::MakeClosure:
+                    frameRegisters[instruction.destination] = {0, makeClosure(instruction.first, frameRegisters,
+                                                                              closure)};
+                    break;
+                case details::Opcode::Call: {
+                    std::size_t callee = frameRegisters[instruction.first].closure;
+
+                    if (callee == 0) {
+                        throw std::logic_error("Fibin: invoked value is not a function.");
+                    }
+
+                    if (callsCount == Capacity) {
+                        throw std::length_error("Fibin: program capacity exceeded.");
+                    }
+
+                    calls[callsCount++] = {address, frame, closure, instruction.destination};
+
+                    Slot parameter = frameRegisters[instruction.second];
+                    frame += Code::functions[closures[closure].function].registers;
+                    closure = callee;
+                    reserve(frame, closures[closure].function);
+                    registers[frame] = parameter;
+                    address = Code::functions[closures[closure].function].entry;
+                    break;
+                }
+                case details::Opcode::Return: {
+                    Slot result = frameRegisters[instruction.destination];
+
+                    if (callsCount == 0) {
+                        return result;
+                    }
+
+                    const Call &caller = calls[--callsCount];
+                    address = caller.address;
+                    frame = caller.frame;
+                    closure = caller.closure;
+                    registers[frame + caller.destination] = result;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::size_t makeClosure(std::size_t function, const Slot *frameRegisters, std::size_t closure) {
+        const details::Function &made = Code::functions[function];
+
+        if (closuresCount == Capacity || Capacity - capturedCount < made.capturesCount) {
+            throw std::length_error("Fibin: program capacity exceeded.");
+        }
+
+        closures[closuresCount] = {function, capturedCount};
+
+        for (std::size_t i = 0; i < made.capturesCount; i++) {
+            const details::Capture &capture = Code::captures[made.capturesBegin + i];
+
+            captured[capturedCount++] = capture.fromCapture ? captured[closures[closure].captured + capture.index]
+                                                            : frameRegisters[capture.index];
+        }
+
+        return closuresCount++;
+    }
+
+    void reserve(std::size_t frame, std::size_t function) {
+        if (Capacity - frame < Code::functions[function].registers) {
+            throw std::length_error("Fibin: program capacity exceeded.");
+        }
+    }
+
+    static ValueType truth(bool value) {
+        return value ? ValueType(1) : ValueType(0);
+    }
+
+    static ValueType number(const Slot &slot) {
+        if (slot.closure != 0) {
+            throw std::logic_error("Fibin: value is not a number.");
+        }
+
+        return slot.number;
+    }
+};
+
 template<typename ValueType>
 class Fibin {
 
 public:
-    template<typename Expression, typename X = ValueType, std::enable_if_t<std::is_integral<X>::value, int> = 0>
+    template<typename Expression, typename X = ValueType, std::enable_if_t<details::IsInteger<X>::value, int> = 0>
     static constexpr ValueType eval() {
-        return Expression::template result<ValueType, details::EmptyList>::numberValue;
+        return Expression::template result<ValueType, details::EmptyScope>::numberValue;
     }
 
-    template<typename Expression, typename X = ValueType, std::enable_if_t<!std::is_integral<X>::value, int> = 0>
+    template<typename Expression, typename X = ValueType, std::enable_if_t<!details::IsInteger<X>::value, int> = 0>
     static constexpr void eval() {
         std::cout << "Fibin doesn't support: " << typeid(ValueType).name() << std::endl;
     }
+
+    // Gives the same results as eval, but evaluates the expression with a constexpr interpreter,
+    // which compiles big expressions much faster. Capacity limits the depth of evaluation,
+    // by default it is the smallest power of two that suffices, up to MAX_INTERPRETER_CAPACITY.
+    template<typename Expression, std::size_t Capacity = 0,
+            typename X = ValueType, std::enable_if_t<details::IsInteger<X>::value, int> = 0>
+    static constexpr ValueType interpret() {
+        constexpr details::Evaluation<ValueType> evaluation = std::conditional_t<Capacity == 0,
+                details::InterpretFitting<ValueType, Expression>,
+                details::Interpret<ValueType, Expression, Capacity>>::evaluation;
+        static_assert(evaluation.fits, "Evaluation of the expression exceeds the capacity of the interpreter.");
+
+        return evaluation.value;
+    }
+
+    // Program evaluating the expression at runtime, see FibinProgram.
+    template<typename Expression, std::size_t Capacity = 1024>
+    using Program = FibinProgram<ValueType, Expression, Capacity>;
 };
 
 #endif //FIBIN_FIBIN_H
@@ -0,0 +1,124 @@
+// Evaluations per second of functions compiled by Fibin<T>::Program, called one by one and in batches,
+// against the same functions written in C++. Results are checked against Fibin<T>::eval.
+// Build: g++ -std=c++17 -O2 program_benchmark.cc -o program_benchmark
+#include "fibin.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    using Value = uint64_t;
+
+    const std::size_t INPUTS = 1 << 20;
+    const std::size_t RECURSIVE_INPUTS = 1 << 12;
+
+    // x < 6765 ? x * x + x + 3 : x % 144
+    using Arithmetic = Lambda<Var("x"), If<Lt<Ref<Var("x")>, Lit<Fib<20>>>,
+            Sum<Mul<Ref<Var("x")>, Ref<Var("x")>>, Ref<Var("x")>, Lit<Fib<4>>>,
+            Mod<Ref<Var("x")>, Lit<Fib<12>>>>>;
+
+    Value arithmetic(Value x) {
+        return x < 6765 ? x * x + x + 3 : x % 144;
+    }
+
+    // Calls a closure capturing k = 13: x * 13 + 13
+    using Closure = Let<Var("k"), Lit<Fib<7>>, Lambda<Var("x"),
+            Invoke<Lambda<Var("y"), Sum<Ref<Var("y")>, Ref<Var("k")>>>, Mul<Ref<Var("x")>, Ref<Var("k")>>>>>;
+
+    Value closure(Value x) {
+        return x * 13 + 13;
+    }
+
+    // Doubly recursive fibonacci numbers.
+    using Recursive = Fix<Var("fib"), Lambda<Var("n"), If<Lt<Ref<Var("n")>, Lit<Fib<3>>>, Ref<Var("n")>,
+            Sum<Invoke<Ref<Var("fib")>, Sub<Ref<Var("n")>, Lit<Fib<1>>>>,
+                    Invoke<Ref<Var("fib")>, Sub<Ref<Var("n")>, Lit<Fib<3>>>>>>>>;
+
+    Value recursive(Value n) {
+        return n < 2 ? n : recursive(n - 1) + recursive(n - 2);
+    }
+
+    // Checks the program against eval on fibonacci numbers, which are the only literals.
+    template<typename Function, std::size_t... Indices>
+    bool matchesEval(std::index_sequence<Indices...>) {
+        typename Fibin<Value>::template Program<Function> program;
+
+        return ((program.run(Fibin<Value>::eval<Lit<Fib<Indices>>>()) ==
+                 Fibin<Value>::eval<Invoke<Function, Lit<Fib<Indices>>>>()) && ...);
+    }
+
+    // Millions of evaluations per second.
+    template<typename Evaluate>
+    double speed(std::size_t count, Evaluate evaluate) {
+        auto begin = std::chrono::steady_clock::now();
+        evaluate();
+        double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+        return count / time / 1e6;
+    }
+
+    template<typename Function>
+    void compare(const std::string &name, const std::vector<Value> &inputs, Value (*native)(Value)) {
+        typename Fibin<Value>::template Program<Function> program;
+        std::vector<Value> expected(inputs.size()), single(inputs.size()), batch(inputs.size());
+
+        double nativeSpeed = speed(inputs.size(), [&] {
+            for (std::size_t i = 0; i < inputs.size(); i++) {
+                expected[i] = native(inputs[i]);
+            }
+        });
+
+        double singleSpeed = speed(inputs.size(), [&] {
+            for (std::size_t i = 0; i < inputs.size(); i++) {
+                single[i] = program.run(inputs[i]);
+            }
+        });
+
+        double batchSpeed = speed(inputs.size(), [&] {
+            program.run(inputs.data(), batch.data(), inputs.size());
+        });
+
+        if (single != expected || batch != expected) {
+            std::cout << name << ": results differ from C++\n";
+            std::exit(EXIT_FAILURE);
+        }
+
+        std::cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << singleSpeed << std::setw(12) << batchSpeed << std::setw(12) << nativeSpeed
+                  << '\n';
+    }
+}
+
+int main() {
+    if (!matchesEval<Arithmetic>(std::make_index_sequence<30>()) ||
+        !matchesEval<Closure>(std::make_index_sequence<30>()) ||
+        !matchesEval<Recursive>(std::make_index_sequence<8>())) {
+        std::cout << "results differ from eval\n";
+        return EXIT_FAILURE;
+    }
+
+    std::mt19937_64 random(2020);
+    std::vector<Value> inputs(INPUTS), recursiveInputs(RECURSIVE_INPUTS);
+
+    for (Value &input : inputs) {
+        input = random() % 10000;
+    }
+
+    for (Value &input : recursiveInputs) {
+        input = random() % 20;
+    }
+
+    std::cout << std::left << std::setw(14) << "function" << std::right << std::setw(12) << "run"
+              << std::setw(12) << "batch" << std::setw(12) << "C++" << "  (millions of evaluations/s)\n";
+
+    compare<Arithmetic>("arithmetic", inputs, arithmetic);
+    compare<Closure>("closure", inputs, closure);
+    compare<Recursive>("recursive", recursiveInputs, recursive);
+}
@@ -0,0 +1,20 @@
+// Pins that variables whose ids agree in the bits which index environments are told apart.
+// Build: g++ -std=c++17 scope_test.cc -o scope_test
+#include "fibin.h"
+
+#include <cstdint>
+
+// Ids of both names end in the same 32 bits, 0xcfee5660.
+static_assert(Var("xmbcmniu") != Var("lvbsifxi") && uint32_t(Var("xmbcmniu")) == uint32_t(Var("lvbsifxi")));
+
+// Both variables are bound in one leaf, the first one is bound again after the second.
+using Colliding = Let<Var("xmbcmniu"), Lit<Fib<1>>,
+        Let<Var("lvbsifxi"), Lit<Fib<3>>,
+                Let<Var("xmbcmniu"), Inc10<Ref<Var("xmbcmniu")>>,
+                        Sum<Ref<Var("xmbcmniu")>, Ref<Var("lvbsifxi")>>>>>;
+
+static_assert(Fibin<uint64_t>::eval<Colliding>() == 58);
+static_assert(Fibin<uint64_t>::interpret<Colliding>() == 58);
+
+int main() {
+}
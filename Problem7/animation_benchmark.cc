@@ -0,0 +1,99 @@
+// Frames per second of animations of a small circle over a static, expensive background, rendered whole
+// and by the incremental renderer, which redraws only the tiles the circle can have changed.
+// Every incremental frame is checked against the full render.
+// Build: g++ -std=c++17 -O2 -pthread animation_benchmark.cc images.cc render.cc profile.cc -o animation_benchmark
+#include "render.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    const std::size_t WIDTH = 640;
+    const std::size_t HEIGHT = 480;
+    const std::size_t FRAMES = 60;
+
+    Image background() {
+        Blend waves = [](const Point p) {
+            double sum = 0;
+
+            for (int i = 0; i < 20; i++) {
+                sum += std::sin(p.first / (20 + i));
+            }
+
+            return std::abs(sum) / 20;
+        };
+
+        return cond(rings(Point(0, 0), 9.0, true, false), rotate(checker(13.0, Colors::white, Colors::black), 0.4),
+                    lerp(waves, polar_checker(10.0, 8, Colors::red, Colors::blue), constant(Colors::caramel)));
+    }
+
+    struct Animation {
+        std::string name;
+        // Frame of the animation over the background
+        std::function<Image(const Image &, std::size_t)> frame;
+    };
+
+    std::vector<Animation> animations() {
+        return {{"moving circle", [](const Image &background, std::size_t frame) {
+            double t = double(frame);
+
+            return cond(translate(circle(Point(0, 0), 15.0, true, false), Vector(-200 + 6 * t, 40 * std::sin(t / 5))),
+                        constant(Colors::green), background);
+        }}, {"rotating circle", [](const Image &background, std::size_t frame) {
+            return cond(rotate(circle(Point(100, 0), 15.0, true, false), 0.1 * double(frame)),
+                        lighten(constant(Colors::green), constant(0.3)), background);
+        }}, {"growing circle", [](const Image &background, std::size_t frame) {
+            return cond(circle(Point(-50, 50), 5.0 + double(frame), true, false), constant(Colors::blue),
+                        background);
+        }}};
+    }
+}
+
+int main() {
+    Image static_background = background();
+    std::vector<unsigned char> full(3 * WIDTH * HEIGHT);
+    Render_options options;
+    options.threads = 1;
+    std::size_t tiles = ((WIDTH + options.tile_size - 1) / options.tile_size) *
+                        ((HEIGHT + options.tile_size - 1) / options.tile_size);
+
+    std::cout << std::left << std::setw(18) << "animation" << std::right << std::setw(12) << "full fps"
+              << std::setw(18) << "incremental fps" << std::setw(16) << "tiles/frame" << '\n';
+
+    for (const Animation &animation : animations()) {
+        Incremental_renderer incremental(WIDTH, HEIGHT, options);
+        double full_time = 0;
+        double incremental_time = 0;
+        std::size_t rendered_tiles = 0;
+
+        for (std::size_t frame = 0; frame < FRAMES; frame++) {
+            Image image = animation.frame(static_background, frame);
+
+            auto begin = std::chrono::steady_clock::now();
+            render(image, WIDTH, HEIGHT, full.data(), options);
+            full_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+            begin = std::chrono::steady_clock::now();
+            incremental.render(image);
+            incremental_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            rendered_tiles += incremental.get_rendered_tiles();
+
+            if (!std::equal(full.begin(), full.end(), incremental.get_frame())) {
+                std::cout << animation.name << ": frame " << frame << " differs\n";
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::cout << std::left << std::setw(18) << animation.name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << FRAMES / full_time << std::setw(18)
+                  << FRAMES / incremental_time << std::setw(10) << double(rendered_tiles) / FRAMES << " of "
+                  << tiles << '\n';
+    }
+}
@@ -0,0 +1,266 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "images.h"
+
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class Sampling {
+    nearest,
+    bilinear
+};
+
+struct Cache_options {
+    Sampling sampling = Sampling::nearest;
+
+    // Tiles used least recently are dropped when they take more bytes than this
+    std::size_t memory = std::size_t(64) << 20;
+};
+
+namespace Detail {
+    inline Color interpolate(const Color &a, const Color &b, double w) {
+        return a.weighted_mean(b, w);
+    }
+
+    inline double interpolate(double a, double b, double w) {
+        return a + (b - a) * w;
+    }
+
+    inline bool interpolate(bool a, bool b, double w) {
+        return w < 0.5 ? a : b;
+    }
+
+    // Image sampled on a grid inside the bounds, tiles of the grid are computed when first needed
+    template<typename T>
+    class Cache_node : public Node<T> {
+        static constexpr std::size_t TILE = 64;
+
+        using Tile = std::vector<T>;
+
+        // Tile used last by one evaluation, to look it up only once for many samples
+        struct Recent {
+            uint64_t key = UINT64_MAX;
+            std::shared_ptr<const Tile> tile;
+        };
+
+    public:
+        Cache_node(const Base_image<T> &image, const Bounds &bounds, double resolution, const Cache_options &options)
+                : image(image), bounds(bounds), resolution(resolution), options(options), sampling(options.sampling),
+                  columns(std::size_t((bounds.right - bounds.left) * resolution) + 1),
+                  rows(std::size_t((bounds.top - bounds.bottom) * resolution) + 1),
+                  max_tiles(std::max<std::size_t>(options.memory / (TILE * TILE * sizeof(T)), 1)) {}
+
+        const char *name() const override {
+            return "cache";
+        }
+
+        std::string signature() const override {
+            return fields(bounds.left, bounds.bottom, bounds.right, bounds.top, resolution, sampling, options.memory);
+        }
+
+        void for_each_input(const std::function<void(const Node_base &)> &visit) const override {
+            visit(*image.get_node());
+        }
+
+        // Caching a constant is pointless
+        std::shared_ptr<const Node<T>> optimize(Optimizer &optimizer) const override {
+            Base_image<T> optimized = optimizer(image);
+
+            if (optimizer.get_pass() == Optimization_pass::constant_folding) {
+                if (const T *value = constant_value(optimized)) {
+                    return std::make_shared<Constant_node<T>>(*value);
+                }
+            }
+
+            if (optimized.get_node() == image.get_node()) {
+                return nullptr;
+            }
+
+            return std::make_shared<Cache_node<T>>(optimized, bounds, resolution, options);
+        }
+
+        // Lookups reach samples up to one step of the grid away
+        std::optional<Support<T>> support() const override {
+            std::optional<Support<T>> inner = image.get_node()->support();
+
+            if (!inner) {
+                return std::nullopt;
+            }
+
+            return Support<T>{inner->bounds.expand(1 / resolution), inner->background};
+        }
+
+        T at(const Point &p) const override {
+            Point q = p.is_polar ? from_polar(p) : p;
+
+            if (!bounds.contains(q.first, q.second)) {
+                return image(p);
+            }
+
+            Recent recent;
+
+            return lookup(q.first, q.second, recent);
+        }
+
+        void evaluate(const Point_block &points, Value_block<T> &values) const override {
+            Point_block cartesian = points;
+            cartesian.to_cartesian();
+            Point_block outside;
+            std::size_t indices[BLOCK];
+            Recent recent;
+
+            for (std::size_t i = 0; i < cartesian.size; i++) {
+                if (bounds.contains(cartesian.first[i], cartesian.second[i])) {
+                    values.set(i, lookup(cartesian.first[i], cartesian.second[i], recent));
+                } else {
+                    outside.first[outside.size] = cartesian.first[i];
+                    outside.second[outside.size] = cartesian.second[i];
+                    indices[outside.size++] = i;
+                }
+            }
+
+            if (outside.size > 0) {
+                Value_block<T> computed;
+                image(outside, computed);
+
+                for (std::size_t i = 0; i < outside.size; i++) {
+                    values.set(indices[i], computed[i]);
+                }
+            }
+        }
+
+    protected:
+        bool changes_of_inputs(const Node<T> &previous, Bounds &result) const override {
+            auto node = dynamic_cast<const Cache_node<T> *>(&previous);
+
+            if (node == nullptr) {
+                return false;
+            }
+
+            result = Detail::changes(image, node->image).expand(1 / resolution);
+
+            return true;
+        }
+
+    private:
+        Base_image<T> image;
+        Bounds bounds;
+        double resolution;
+        Cache_options options;
+        Sampling sampling;
+        std::size_t columns;
+        std::size_t rows;
+        std::size_t max_tiles;
+        mutable std::mutex mutex;
+        // Tiles from the most recently used, with an index by their keys
+        mutable std::list<std::pair<uint64_t, std::shared_ptr<const Tile>>> tiles;
+        mutable std::unordered_map<uint64_t, typename decltype(tiles)::iterator> index;
+
+        T lookup(double x, double y, Recent &recent) const {
+            double column = (x - bounds.left) * resolution;
+            double row = (y - bounds.bottom) * resolution;
+
+            if (sampling == Sampling::nearest) {
+                return sample(std::min(std::size_t(std::lround(column)), columns - 1),
+                              std::min(std::size_t(std::lround(row)), rows - 1), recent);
+            }
+
+            std::size_t i = std::min(std::size_t(column), columns > 1 ? columns - 2 : 0);
+            std::size_t j = std::min(std::size_t(row), rows > 1 ? rows - 2 : 0);
+            double u = std::min(std::max(column - double(i), 0.0), 1.0);
+            double v = std::min(std::max(row - double(j), 0.0), 1.0);
+
+            return interpolate(interpolate(sample(i, j, recent), sample(i + 1, j, recent), u),
+                               interpolate(sample(i, j + 1, recent), sample(i + 1, j + 1, recent), u), v);
+        }
+
+        T sample(std::size_t column, std::size_t row, Recent &recent) const {
+            uint64_t key = uint64_t(row / TILE) << 32 | uint64_t(column / TILE);
+
+            if (key != recent.key) {
+                recent.key = key;
+                recent.tile = get_tile(column / TILE, row / TILE, key);
+            }
+
+            return (*recent.tile)[row % TILE * TILE + column % TILE];
+        }
+
+        std::shared_ptr<const Tile> get_tile(std::size_t tile_column, std::size_t tile_row, uint64_t key) const {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto found = index.find(key);
+
+                if (found != index.end()) {
+                    tiles.splice(tiles.begin(), tiles, found->second);
+
+                    return found->second->second;
+                }
+            }
+
+            // Computed without the lock, so two threads may compute the same tile and one copy is dropped
+            std::shared_ptr<const Tile> tile = compute_tile(tile_column, tile_row);
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = index.find(key);
+
+            if (found != index.end()) {
+                return found->second->second;
+            }
+
+            tiles.emplace_front(key, tile);
+            index[key] = tiles.begin();
+
+            if (tiles.size() > max_tiles) {
+                index.erase(tiles.back().first);
+                tiles.pop_back();
+            }
+
+            return tile;
+        }
+
+        std::shared_ptr<const Tile> compute_tile(std::size_t tile_column, std::size_t tile_row) const {
+            auto tile = std::make_shared<Tile>();
+            tile->reserve(TILE * TILE);
+            Point_block points;
+            Value_block<T> values;
+
+            for (std::size_t j = 0; j < TILE; j++) {
+                for (std::size_t i = 0; i < TILE; i += BLOCK) {
+                    points.size = BLOCK;
+
+                    for (std::size_t k = 0; k < BLOCK; k++) {
+                        points.first[k] = bounds.left + double(tile_column * TILE + i + k) / resolution;
+                        points.second[k] = bounds.bottom + double(tile_row * TILE + j) / resolution;
+                    }
+
+                    image(points, values);
+
+                    for (std::size_t k = 0; k < BLOCK; k++) {
+                        tile->push_back(values[k]);
+                    }
+                }
+            }
+
+            return tile;
+        }
+    };
+}
+
+// Image sampled once into a grid of resolution points per unit inside the bounds, lazily and tile
+// by tile, later evaluations there look the grid up. Points outside the bounds evaluate the image.
+template<typename T>
+Base_image<T> cache(const Base_image<T> &image, const Bounds &bounds, double resolution,
+                    const Cache_options &options = Cache_options()) {
+    assert(resolution > 0 && bounds.left <= bounds.right && bounds.bottom <= bounds.top);
+
+    return Base_image<T>(std::make_shared<Detail::Cache_node<T>>(image, bounds, resolution, options));
+}
+
+#endif //CACHE_H
@@ -0,0 +1,94 @@
+// Rendering time of scenes which blend rotated copies of one expensive sub-image, evaluating the sub-image
+// at every use and sampling it once by cache, by nearest and by bilinear lookup, on one thread.
+// Cached images are approximations, so their mean difference from the exact render is also given.
+// Build: g++ -std=c++17 -O2 -pthread cache_benchmark.cc images.cc render.cc profile.cc -o cache_benchmark
+#include "cache.h"
+#include "render.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+    const std::size_t WIDTH = 400;
+    const std::size_t HEIGHT = 400;
+
+    // Bounds of the sub-image covering the frame under any rotation
+    const Bounds BOUNDS{-290, -290, 290, 290};
+
+    Image sub_image() {
+        Blend waves = [](const Point p) {
+            double sum = 0;
+
+            for (int i = 0; i < 100; i++) {
+                sum += std::sin(p.first / (30 + i) + p.second / 50);
+            }
+
+            return std::abs(sum) / 100;
+        };
+
+        return lerp(waves, rings(Point(0, 0), 5.0, Colors::red, Colors::blue), constant(Colors::white));
+    }
+
+    // The image blended equally with its copies rotated further and further
+    Image scene(const Image &image, std::size_t uses) {
+        Image result = image;
+
+        for (std::size_t i = 1; i < uses; i++) {
+            result = lerp(constant(1.0 / double(i + 1)), rotate(image, 0.2 * double(i)), result);
+        }
+
+        return result;
+    }
+
+    double render_time(const Image &image, std::vector<unsigned char> &pixels) {
+        Render_options options;
+        options.threads = 1;
+
+        auto begin = std::chrono::steady_clock::now();
+        render(image, WIDTH, HEIGHT, pixels.data(), options);
+
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    // Mean difference of channels, out of 255
+    double difference(const std::vector<unsigned char> &first, const std::vector<unsigned char> &second) {
+        double sum = 0;
+
+        for (std::size_t i = 0; i < first.size(); i++) {
+            sum += std::abs(int(first[i]) - int(second[i]));
+        }
+
+        return sum / first.size();
+    }
+}
+
+int main() {
+    Image sub = sub_image();
+    std::vector<unsigned char> exact(3 * WIDTH * HEIGHT), cached(3 * WIDTH * HEIGHT);
+
+    std::cout << std::setw(6) << "uses" << std::setw(12) << "sampling" << std::setw(12) << "resolution"
+              << std::setw(12) << "uncached s" << std::setw(12) << "cached s" << std::setw(10) << "speedup"
+              << std::setw(12) << "difference" << '\n';
+
+    for (std::size_t uses : {1, 2, 4, 8}) {
+        double uncached_time = render_time(scene(sub, uses), exact);
+
+        for (Sampling sampling : {Sampling::nearest, Sampling::bilinear}) {
+            for (double resolution : {1.0, 2.0}) {
+                Cache_options options;
+                options.sampling = sampling;
+                // A new cache is made for every render, so that its sampling is measured too
+                double cached_time = render_time(scene(cache(sub, BOUNDS, resolution, options), uses), cached);
+
+                std::cout << std::fixed << std::setw(6) << uses << std::setw(12)
+                          << (sampling == Sampling::nearest ? "nearest" : "bilinear") << std::setprecision(1)
+                          << std::setw(12) << resolution << std::setprecision(3) << std::setw(12) << uncached_time
+                          << std::setw(12) << cached_time << std::setprecision(2) << std::setw(10)
+                          << uncached_time / cached_time << std::setw(12) << difference(exact, cached) << '\n';
+            }
+        }
+    }
+}
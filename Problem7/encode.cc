@@ -0,0 +1,452 @@
+#include "encode.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+    const std::size_t MAX_PNG_SIDE = 0x7FFFFFFF;
+
+    const std::size_t MAX_STORED_BLOCK = 65535;
+
+    const std::size_t WINDOW_SIZE = 32768;
+
+    const std::size_t MIN_MATCH = 3;
+
+    const std::size_t MAX_MATCH = 258;
+
+    const std::size_t HASH_BITS = 15;
+
+    const std::size_t MAX_CHAIN = 32;
+
+    const std::array<uint16_t, 29> LENGTH_BASE = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43,
+                                                  51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+    const std::array<uint8_t, 29> LENGTH_EXTRA = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4,
+                                                  4, 4, 5, 5, 5, 5, 0};
+
+    const std::array<uint16_t, 30> DISTANCE_BASE = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257,
+                                                    385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289,
+                                                    16385, 24577};
+
+    const std::array<uint8_t, 30> DISTANCE_EXTRA = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9,
+                                                    9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+    uint32_t crc32(uint32_t crc, const unsigned char *data, std::size_t size) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> result{};
+
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+
+                for (int k = 0; k < 8; k++) {
+                    c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+
+                result[i] = c;
+            }
+
+            return result;
+        }();
+
+        crc = ~crc;
+
+        for (std::size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return ~crc;
+    }
+
+    class Adler32 {
+    public:
+        void update(const unsigned char *data, std::size_t size) {
+            // 5552 is the most bytes that can be summed before the sums overflow 32 bits
+            while (size > 0) {
+                std::size_t part = std::min<std::size_t>(size, 5552);
+
+                for (std::size_t i = 0; i < part; i++) {
+                    a += data[i];
+                    b += a;
+                }
+
+                a %= 65521;
+                b %= 65521;
+                data += part;
+                size -= part;
+            }
+        }
+
+        uint32_t value() const {
+            return b << 16 | a;
+        }
+
+    private:
+        uint32_t a = 1;
+        uint32_t b = 0;
+    };
+
+    // Writes bits from the lowest, as deflate does, keeping the bits of an unfinished byte
+    class Bit_writer {
+    public:
+        void put(uint32_t value, unsigned count, std::vector<unsigned char> &out) {
+            bits |= uint64_t(value) << count_bits;
+            count_bits += count;
+
+            while (count_bits >= 8) {
+                out.push_back(static_cast<unsigned char>(bits));
+                bits >>= 8;
+                count_bits -= 8;
+            }
+        }
+
+        // Huffman codes are written from the highest bit
+        void put_code(uint32_t code, unsigned length, std::vector<unsigned char> &out) {
+            uint32_t reversed = 0;
+
+            for (unsigned i = 0; i < length; i++) {
+                reversed |= ((code >> i) & 1) << (length - 1 - i);
+            }
+
+            put(reversed, length, out);
+        }
+
+        void align(std::vector<unsigned char> &out) {
+            if (count_bits > 0) {
+                put(0, 8 - count_bits, out);
+            }
+        }
+
+    private:
+        uint64_t bits = 0;
+        unsigned count_bits = 0;
+    };
+
+    // Deflate stream written in parts, as stored blocks or as blocks with the fixed Huffman code
+    // and matches found with hash chains. Matches can reach into the data of earlier parts.
+    class Deflater {
+    public:
+        explicit Deflater(bool compress) : compress(compress) {}
+
+        void write(const unsigned char *data, std::size_t size, std::vector<unsigned char> &out) {
+            if (compress) {
+                write_fixed(data, size, out);
+            } else {
+                write_stored(data, size, out);
+            }
+        }
+
+        // Ends the stream with an empty final stored block
+        void finish(std::vector<unsigned char> &out) {
+            bits.put(1, 3, out);
+            bits.align(out);
+            out.insert(out.end(), {0x00, 0x00, 0xFF, 0xFF});
+        }
+
+    private:
+        bool compress;
+        Bit_writer bits;
+        std::vector<unsigned char> window;
+
+        void write_stored(const unsigned char *data, std::size_t size, std::vector<unsigned char> &out) {
+            for (std::size_t begin = 0; begin < size; begin += MAX_STORED_BLOCK) {
+                std::size_t length = std::min(MAX_STORED_BLOCK, size - begin);
+                bits.put(0, 3, out);
+                bits.align(out);
+                bits.put(uint32_t(length), 16, out);
+                bits.put(uint32_t(~length & 0xFFFF), 16, out);
+                out.insert(out.end(), data + begin, data + begin + length);
+            }
+        }
+
+        void put_literal(unsigned literal, std::vector<unsigned char> &out) {
+            if (literal < 144) {
+                bits.put_code(0x30 + literal, 8, out);
+            } else if (literal < 256) {
+                bits.put_code(0x190 + literal - 144, 9, out);
+            } else if (literal < 280) {
+                bits.put_code(literal - 256, 7, out);
+            } else {
+                bits.put_code(0xC0 + literal - 280, 8, out);
+            }
+        }
+
+        void put_match(std::size_t length, std::size_t distance, std::vector<unsigned char> &out) {
+            std::size_t code = 0;
+
+            while (code + 1 < LENGTH_BASE.size() && LENGTH_BASE[code + 1] <= length) {
+                code++;
+            }
+
+            put_literal(257 + unsigned(code), out);
+            bits.put(uint32_t(length - LENGTH_BASE[code]), LENGTH_EXTRA[code], out);
+            code = 0;
+
+            while (code + 1 < DISTANCE_BASE.size() && DISTANCE_BASE[code + 1] <= distance) {
+                code++;
+            }
+
+            bits.put_code(uint32_t(code), 5, out);
+            bits.put(uint32_t(distance - DISTANCE_BASE[code]), DISTANCE_EXTRA[code], out);
+        }
+
+        static std::size_t hash(const unsigned char *p) {
+            return ((uint32_t(p[0]) << 16 | uint32_t(p[1]) << 8 | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+        }
+
+        void write_fixed(const unsigned char *data, std::size_t size, std::vector<unsigned char> &out) {
+            std::size_t start = window.size();
+            window.insert(window.end(), data, data + size);
+            std::vector<uint32_t> head(std::size_t(1) << HASH_BITS, UINT32_MAX);
+            std::vector<uint32_t> previous(window.size(), UINT32_MAX);
+
+            auto insert = [&](std::size_t position) {
+                if (position + MIN_MATCH <= window.size()) {
+                    std::size_t h = hash(&window[position]);
+                    previous[position] = head[h];
+                    head[h] = uint32_t(position);
+                }
+            };
+
+            for (std::size_t position = 0; position < start; position++) {
+                insert(position);
+            }
+
+            bits.put(2, 3, out);
+
+            for (std::size_t position = start; position < window.size();) {
+                std::size_t best_length = 0;
+                std::size_t best_distance = 0;
+
+                if (position + MIN_MATCH <= window.size()) {
+                    std::size_t limit = std::min(MAX_MATCH, window.size() - position);
+                    uint32_t candidate = head[hash(&window[position])];
+
+                    for (std::size_t chain = 0; chain < MAX_CHAIN && candidate != UINT32_MAX
+                                                && position - candidate <= WINDOW_SIZE; chain++) {
+                        std::size_t length = 0;
+
+                        while (length < limit && window[candidate + length] == window[position + length]) {
+                            length++;
+                        }
+
+                        if (length > best_length) {
+                            best_length = length;
+                            best_distance = position - candidate;
+                        }
+
+                        candidate = previous[candidate];
+                    }
+                }
+
+                if (best_length >= MIN_MATCH) {
+                    put_match(best_length, best_distance, out);
+
+                    for (std::size_t i = 0; i < best_length; i++) {
+                        insert(position + i);
+                    }
+
+                    position += best_length;
+                } else {
+                    put_literal(window[position], out);
+                    insert(position);
+                    position++;
+                }
+            }
+
+            put_literal(256, out);
+
+            if (window.size() > WINDOW_SIZE) {
+                window.erase(window.begin(), window.end() - WINDOW_SIZE);
+            }
+        }
+    };
+
+    class Encoder {
+    public:
+        virtual ~Encoder() = default;
+
+        // Encodes the next rows of the frame
+        virtual void write(const unsigned char *rows, std::size_t count) = 0;
+
+        virtual void finish() = 0;
+    };
+
+    class Ppm_encoder : public Encoder {
+    public:
+        Ppm_encoder(std::ostream &os, std::size_t width, std::size_t height) : os(os), width(width) {
+            os << "P6\n" << width << ' ' << height << "\n255\n";
+        }
+
+        void write(const unsigned char *rows, std::size_t count) override {
+            os.write(reinterpret_cast<const char *>(rows), std::streamsize(3 * width * count));
+        }
+
+        void finish() override {
+            os.flush();
+        }
+
+    private:
+        std::ostream &os;
+        std::size_t width;
+    };
+
+    // PNG with 8-bit RGB pixels, each band of rows goes into its own IDAT chunk
+    class Png_encoder : public Encoder {
+    public:
+        Png_encoder(std::ostream &os, std::size_t width, std::size_t height, bool compress)
+                : os(os), width(width), deflater(compress), compress(compress), previous_row(3 * width) {
+            static const unsigned char SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+            os.write(reinterpret_cast<const char *>(SIGNATURE), sizeof(SIGNATURE));
+
+            std::vector<unsigned char> header;
+            put32(header, uint32_t(width));
+            put32(header, uint32_t(height));
+            header.insert(header.end(), {8, 2, 0, 0, 0});
+            write_chunk("IHDR", header);
+
+            // zlib header: deflate with a 32K window, no preset dictionary
+            data.insert(data.end(), {0x78, 0x01});
+        }
+
+        void write(const unsigned char *rows, std::size_t count) override {
+            std::size_t stride = 3 * width;
+            scanlines.clear();
+
+            for (std::size_t y = 0; y < count; y++) {
+                const unsigned char *row = rows + y * stride;
+                filter(row);
+                std::copy(row, row + stride, previous_row.begin());
+            }
+
+            adler.update(scanlines.data(), scanlines.size());
+            deflater.write(scanlines.data(), scanlines.size(), data);
+            write_chunk("IDAT", data);
+            data.clear();
+        }
+
+        void finish() override {
+            deflater.finish(data);
+            put32(data, adler.value());
+            write_chunk("IDAT", data);
+            data.clear();
+            write_chunk("IEND", data);
+            os.flush();
+        }
+
+    private:
+        std::ostream &os;
+        std::size_t width;
+        Deflater deflater;
+        bool compress;
+        Adler32 adler;
+        std::vector<unsigned char> previous_row;
+        std::vector<unsigned char> scanlines;
+        std::vector<unsigned char> data;
+
+        static void put32(std::vector<unsigned char> &bytes, uint32_t value) {
+            bytes.insert(bytes.end(), {static_cast<unsigned char>(value >> 24), static_cast<unsigned char>(value >> 16),
+                                       static_cast<unsigned char>(value >> 8), static_cast<unsigned char>(value)});
+        }
+
+        // Compressed rows are filtered by the row above (filter Up), which turns
+        // the flat areas typical for these images into runs of zeros
+        void filter(const unsigned char *row) {
+            std::size_t stride = 3 * width;
+
+            if (!compress) {
+                scanlines.push_back(0);
+                scanlines.insert(scanlines.end(), row, row + stride);
+                return;
+            }
+
+            scanlines.push_back(2);
+
+            for (std::size_t i = 0; i < stride; i++) {
+                scanlines.push_back(static_cast<unsigned char>(row[i] - previous_row[i]));
+            }
+        }
+
+        void write_chunk(const char *type, const std::vector<unsigned char> &chunk) {
+            std::vector<unsigned char> length;
+            put32(length, uint32_t(chunk.size()));
+            os.write(reinterpret_cast<const char *>(length.data()), 4);
+            os.write(type, 4);
+            os.write(reinterpret_cast<const char *>(chunk.data()), std::streamsize(chunk.size()));
+
+            uint32_t crc = crc32(0, reinterpret_cast<const unsigned char *>(type), 4);
+            std::vector<unsigned char> checksum;
+            put32(checksum, crc32(crc, chunk.data(), chunk.size()));
+            os.write(reinterpret_cast<const char *>(checksum.data()), 4);
+        }
+    };
+
+    std::unique_ptr<Encoder> make_encoder(std::ostream &os, std::size_t width, std::size_t height,
+                                          Image_format format) {
+        switch (format) {
+            case Image_format::ppm:
+                return std::make_unique<Ppm_encoder>(os, width, height);
+            case Image_format::png_stored:
+                return std::make_unique<Png_encoder>(os, width, height, false);
+            case Image_format::png_deflate:
+                return std::make_unique<Png_encoder>(os, width, height, true);
+        }
+
+        return nullptr;
+    }
+}
+
+bool write_image(std::ostream &os, const Image &image, std::size_t width, std::size_t height,
+                 const Encode_options &options) {
+    assert(options.band_height > 0);
+
+    // PNG allows neither empty frames nor sides longer than 2^31 - 1
+    if (width == 0 || height == 0
+        || (options.format != Image_format::ppm && std::max(width, height) > MAX_PNG_SIDE)) {
+        return false;
+    }
+
+    std::unique_ptr<Encoder> encoder = make_encoder(os, width, height, options.format);
+
+    if (!os) {
+        return false;
+    }
+
+    std::size_t band_size = 3 * width * options.band_height;
+    std::vector<unsigned char> current(band_size);
+    std::vector<unsigned char> next(band_size);
+
+    auto render_band = [&](std::size_t top, std::vector<unsigned char> &band) {
+        return render(image, width, height, top, std::min(top + options.band_height, height), band.data(),
+                      options.render);
+    };
+
+    if (!render_band(0, current)) {
+        return false;
+    }
+
+    for (std::size_t top = 0; top < height; top += options.band_height) {
+        std::future<bool> rendered;
+
+        if (top + options.band_height < height) {
+            rendered = std::async(std::launch::async, render_band, top + options.band_height, std::ref(next));
+        }
+
+        encoder->write(current.data(), std::min(options.band_height, height - top));
+
+        // The band being rendered is finished before returning, as it is rendered into next
+        if (!os || (rendered.valid() && !rendered.get())) {
+            return false;
+        }
+
+        current.swap(next);
+    }
+
+    encoder->finish();
+
+    return bool(os);
+}
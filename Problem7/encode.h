@@ -0,0 +1,32 @@
+#ifndef ENCODE_H
+#define ENCODE_H
+
+#include "render.h"
+
+#include <cstddef>
+#include <ostream>
+
+enum class Image_format {
+    ppm,
+    png_stored,
+    png_deflate
+};
+
+struct Encode_options {
+    Image_format format = Image_format::png_deflate;
+
+    // Number of rows rendered and encoded at once
+    std::size_t band_height = 64;
+
+    Render_options render;
+};
+
+// Renders the image band by band and writes it to the stream as binary PPM or PNG, uncompressed
+// or compressed with deflate. The next band is rendered while the previous one is encoded,
+// so memory use is bounded by a few bands regardless of the height of the frame.
+// Returns false if rendering was cancelled or writing failed, the output is incomplete then.
+// Frames without pixels, and for PNG frames with a side longer than 2^31 - 1, are not written at all.
+bool write_image(std::ostream &os, const Image &image, std::size_t width, std::size_t height,
+                 const Encode_options &options = Encode_options());
+
+#endif //ENCODE_H
@@ -0,0 +1,440 @@
+#ifndef IMAGE_NODE_H
+#define IMAGE_NODE_H
+
+#include "coordinate.h"
+#include "color.h"
+#include "profile.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+// Number of points evaluated by one call of a batched kernel, values of regions
+// at all points of a block are packed into one word
+constexpr std::size_t BLOCK = 64;
+
+using Mask = uint64_t;
+
+static_assert(BLOCK <= 64, "values of a region at a block must fit in a mask");
+
+// Mask of the first size points of a block
+inline Mask lanes(std::size_t size) {
+    return size >= 64 ? ~Mask{0} : (Mask{1} << size) - 1;
+}
+
+// Rectangle of the plane in cartesian coordinates, possibly empty or unbounded
+struct Bounds {
+    double left;
+    double bottom;
+    double right;
+    double top;
+
+    static Bounds empty() {
+        double infinity = std::numeric_limits<double>::infinity();
+
+        return {infinity, infinity, -infinity, -infinity};
+    }
+
+    static Bounds everything() {
+        double infinity = std::numeric_limits<double>::infinity();
+
+        return {-infinity, -infinity, infinity, infinity};
+    }
+
+    bool is_empty() const {
+        return left > right || bottom > top;
+    }
+
+    bool is_bounded() const {
+        return std::isfinite(left) && std::isfinite(bottom) && std::isfinite(right) && std::isfinite(top);
+    }
+
+    bool contains(double x, double y) const {
+        return left <= x && x <= right && bottom <= y && y <= top;
+    }
+
+    Bounds unite(const Bounds &other) const {
+        return {std::min(left, other.left), std::min(bottom, other.bottom), std::max(right, other.right),
+                std::max(top, other.top)};
+    }
+
+    Bounds intersect(const Bounds &other) const {
+        return {std::max(left, other.left), std::max(bottom, other.bottom), std::min(right, other.right),
+                std::min(top, other.top)};
+    }
+
+    Bounds expand(double margin) const {
+        return is_empty() ? *this : Bounds{left - margin, bottom - margin, right + margin, top + margin};
+    }
+};
+
+// Points evaluated together, with coordinates in separate arrays so that loops over them
+// are vectorized by the compiler. All points of a block are either cartesian or polar.
+struct Point_block {
+    std::size_t size = 0;
+    bool is_polar = false;
+    alignas(64) double first[BLOCK] = {};
+    alignas(64) double second[BLOCK] = {};
+
+    Point operator[](std::size_t i) const {
+        return Point(first[i], second[i], is_polar);
+    }
+
+    void to_cartesian() {
+        if (!is_polar) {
+            return;
+        }
+
+        for (std::size_t i = 0; i < size; i++) {
+            double r = first[i];
+            first[i] = r * std::cos(second[i]);
+            second[i] = r * std::sin(second[i]);
+        }
+
+        is_polar = false;
+    }
+
+    void to_polar() {
+        if (is_polar) {
+            return;
+        }
+
+        for (std::size_t i = 0; i < size; i++) {
+            double x = first[i];
+            first[i] = std::sqrt(x * x + second[i] * second[i]);
+            second[i] = std::atan2(second[i], x);
+        }
+
+        is_polar = true;
+    }
+};
+
+// Values of an image at the points of a block. They are constructed in place,
+// as the value type (e.g. Color) does not have to be default constructible or assignable.
+template<typename T>
+class Value_block {
+    static_assert(std::is_trivially_destructible<T>::value, "values are overwritten without being destroyed");
+
+public:
+    const T &operator[](std::size_t i) const {
+        return *std::launder(reinterpret_cast<const T *>(&values[i]));
+    }
+
+    void set(std::size_t i, const T &value) {
+        new(&values[i]) T(value);
+    }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type values[BLOCK];
+};
+
+// Values of a region are bits of a mask, so that regions are combined a whole word at a time
+template<>
+class Value_block<bool> {
+public:
+    bool operator[](std::size_t i) const {
+        return (mask >> i) & 1;
+    }
+
+    void set(std::size_t i, bool value) {
+        mask = (mask & ~(Mask{1} << i)) | Mask{value} << i;
+    }
+
+    Mask get_mask() const {
+        return mask;
+    }
+
+    void set_mask(Mask mask) {
+        this->mask = mask;
+    }
+
+private:
+    Mask mask = 0;
+};
+
+namespace Detail {
+    // Values are written field by field, so that equal values give equal strings
+    // whatever the padding of their types. Zeros of both signs are equal.
+    inline void append_value(std::string &result, double value) {
+        value = value == 0 ? 0.0 : value;
+        result.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template<typename T, typename = std::enable_if_t<std::is_integral<T>::value || std::is_enum<T>::value>>
+    void append_value(std::string &result, T value) {
+        auto number = static_cast<uint64_t>(value);
+        result.append(reinterpret_cast<const char *>(&number), sizeof(number));
+    }
+
+    inline void append_value(std::string &result, const Color &color) {
+        append_value(result, color.red);
+        append_value(result, color.green);
+        append_value(result, color.blue);
+    }
+
+    inline void append_value(std::string &result, const void *address) {
+        append_value(result, reinterpret_cast<uintptr_t>(address));
+    }
+
+    // Values one after another
+    template<typename ...Args>
+    std::string fields(const Args &...args) {
+        std::string result;
+        (append_value(result, args), ...);
+
+        return result;
+    }
+
+    template<typename T>
+    bool same_values(const T &first, const T &second) {
+        return fields(first) == fields(second);
+    }
+}
+
+// Part of an image graph independent of the type of values, for passes over the whole graph
+class Node_base {
+public:
+    virtual ~Node_base() = default;
+
+    // Name of the combinator which made the node
+    virtual const char *name() const = 0;
+
+    // Parameters of the node other than its inputs, nodes with equal names,
+    // signatures and inputs are equal. Nodes equal only to themselves give their address.
+    virtual std::string signature() const {
+        return Detail::fields(static_cast<const void *>(this));
+    }
+
+    virtual void for_each_input(const std::function<void(const Node_base &)> &) const {}
+};
+
+template<typename T>
+class Base_image;
+
+class Optimizer;
+
+// Bounds outside of which an image has the background value
+template<typename T>
+struct Support {
+    Bounds bounds;
+    T background;
+};
+
+template<typename T>
+class Node : public Node_base {
+public:
+    virtual T at(const Point &p) const = 0;
+
+    // Kernels of combinators override this, by default points are evaluated one by one
+    virtual void evaluate(const Point_block &points, Value_block<T> &values) const {
+        for (std::size_t i = 0; i < points.size; i++) {
+            values.set(i, at(points[i]));
+        }
+    }
+
+    // Simplified node or null if it cannot be simplified, nodes with inputs pass them to the optimizer
+    virtual std::shared_ptr<const Node<T>> optimize(Optimizer &) const {
+        return nullptr;
+    }
+
+    // Support of the image if it is known
+    virtual std::optional<Support<T>> support() const {
+        return std::nullopt;
+    }
+
+    // Bounds of the points where the image can differ from the previous one. Images made by the same
+    // combinator with the same parameters differ only where their inputs do, others only inside
+    // their supports, if they have the same background.
+    Bounds changes(const Node<T> &previous) const {
+        if (this == &previous) {
+            return Bounds::empty();
+        }
+
+        Bounds result = Bounds::empty();
+
+        if (std::strcmp(this->name(), previous.name()) == 0 && this->signature() == previous.signature()
+            && changes_of_inputs(previous, result)) {
+            return result;
+        }
+
+        std::optional<Support<T>> current_support = support();
+        std::optional<Support<T>> previous_support = previous.support();
+
+        if (current_support && previous_support
+            && Detail::same_values(current_support->background, previous_support->background)) {
+            return current_support->bounds.unite(previous_support->bounds);
+        }
+
+        return Bounds::everything();
+    }
+
+protected:
+    // Sets the result to the bounds of changes of the inputs, mapped to the points of this image, if the
+    // previous node, made by the same combinator with the same parameters, has the inputs in the same roles
+    virtual bool changes_of_inputs(const Node<T> &, Bounds &) const {
+        bool has_inputs = false;
+
+        this->for_each_input([&](const Node_base &) {
+            has_inputs = true;
+        });
+
+        return !has_inputs;
+    }
+};
+
+namespace Detail {
+    // Image given by any function of a point, it has no batched kernel
+    template<typename T, typename F>
+    class Function_node : public Node<T> {
+    public:
+        explicit Function_node(F f) : f(std::move(f)) {}
+
+        const char *name() const override {
+            return "function";
+        }
+
+        T at(const Point &p) const override {
+            return f(p);
+        }
+
+    private:
+        F f;
+    };
+}
+
+namespace Detail {
+    // Bounds of the points where the image can differ from the previous one
+    template<typename T>
+    Bounds changes(const Base_image<T> &current, const Base_image<T> &previous);
+}
+
+// Image as a shared, immutable graph of nodes. It can be built from any function of a point,
+// like std::function, and combinators from images.h build nodes with batched kernels.
+template<typename T>
+class Base_image {
+public:
+    Base_image() = default;
+
+    template<typename F, typename = std::enable_if_t<
+            !std::is_same<std::decay_t<F>, Base_image>::value && std::is_invocable_r<T, const F &, const Point>::value>>
+    Base_image(F f) : node(std::make_shared<Detail::Function_node<T, F>>(std::move(f))) {}
+
+    explicit Base_image(std::shared_ptr<const Node<T>> node) : node(std::move(node)) {}
+
+    // Images without a node throw std::bad_function_call, as std::function does
+    T operator()(const Point p) const {
+        const Node<T> &node = get();
+#ifdef IMAGES_PROFILING
+        Profile_scope scope(node, 1);
+#endif
+        return node.at(p);
+    }
+
+    void operator()(const Point_block &points, Value_block<T> &values) const {
+        const Node<T> &node = get();
+#ifdef IMAGES_PROFILING
+        Profile_scope scope(node, points.size);
+#endif
+        node.evaluate(points, values);
+    }
+
+    const std::shared_ptr<const Node<T>> &get_node() const {
+        return node;
+    }
+
+    explicit operator bool() const {
+        return node != nullptr;
+    }
+
+private:
+    std::shared_ptr<const Node<T>> node;
+
+    const Node<T> &get() const {
+        if (node == nullptr) {
+            throw std::bad_function_call();
+        }
+
+        return *node;
+    }
+};
+
+namespace Detail {
+    template<typename T>
+    Bounds changes(const Base_image<T> &current, const Base_image<T> &previous) {
+        if (!current.get_node() || !previous.get_node()) {
+            return current.get_node() == previous.get_node() ? Bounds::empty() : Bounds::everything();
+        }
+
+        return current.get_node()->changes(*previous.get_node());
+    }
+}
+
+enum class Optimization_pass {
+    constant_folding,
+    common_subexpressions,
+    dead_branches
+};
+
+// Runs one pass over a graph, every node is optimized once and keeps being shared by all its users
+class Optimizer {
+public:
+    explicit Optimizer(Optimization_pass pass) : pass(pass) {}
+
+    Optimization_pass get_pass() const {
+        return pass;
+    }
+
+    template<typename T>
+    Base_image<T> operator()(const Base_image<T> &image) {
+        const std::shared_ptr<const Node<T>> &node = image.get_node();
+
+        if (!node) {
+            return image;
+        }
+
+        auto found = optimized.find(node.get());
+
+        if (found != optimized.end()) {
+            return Base_image<T>(std::static_pointer_cast<const Node<T>>(found->second));
+        }
+
+        std::shared_ptr<const Node<T>> result = node->optimize(*this);
+
+        if (!result) {
+            result = node;
+        }
+
+        if (pass == Optimization_pass::common_subexpressions) {
+            std::string key = std::string(typeid(T).name()) + '\0' + result->name() + '\0' + result->signature();
+
+            result->for_each_input([&](const Node_base &input) {
+                key += Detail::fields(static_cast<const void *>(&input));
+            });
+
+            result = std::static_pointer_cast<const Node<T>>(shared.emplace(key, result).first->second);
+        }
+
+        optimized.emplace(node.get(), result);
+
+        return Base_image<T>(result);
+    }
+
+private:
+    Optimization_pass pass;
+    std::unordered_map<const Node_base *, std::shared_ptr<const Node_base>> optimized;
+    // Nodes by their names, signatures and inputs
+    std::unordered_map<std::string, std::shared_ptr<const Node_base>> shared;
+};
+
+#endif //IMAGE_NODE_H
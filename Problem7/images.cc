@@ -1,11 +1,400 @@
 #include "images.h"
 
+namespace Detail {
+    namespace {
+        // Images which are the same node
+        template<typename T>
+        bool same(const Base_image<T> &first, const Base_image<T> &second) {
+            return first.get_node() == second.get_node();
+        }
+
+        // Bounds of the points where the region can have the value
+        Bounds reach(const Region &region, bool value) {
+            std::optional<Support<bool>> support = region.get_node()->support();
+
+            return support && support->background != value ? support->bounds : Bounds::everything();
+        }
+
+        bool apply(Region_operation operation, bool first, bool second) {
+            switch (operation) {
+                case Region_operation::intersection:
+                    return first && second;
+                case Region_operation::sum:
+                    return first || second;
+                case Region_operation::symmetric_difference:
+                    return first != second;
+                case Region_operation::complement:
+                    return !first;
+            }
+
+            return false;
+        }
+    }
+
+    Region_node::Region_node(Region_operation operation, const Region &first, const Region &second)
+            : operation(operation), first(first), second(second) {}
+
+    const char *Region_node::name() const {
+        switch (operation) {
+            case Region_operation::intersection:
+                return "and";
+            case Region_operation::sum:
+                return "or";
+            case Region_operation::symmetric_difference:
+                return "xor";
+            case Region_operation::complement:
+                return "not";
+        }
+
+        return "";
+    }
+
+    std::string Region_node::signature() const {
+        return "";
+    }
+
+    void Region_node::for_each_input(const std::function<void(const Node_base &)> &visit) const {
+        visit(*first.get_node());
+
+        if (second) {
+            visit(*second.get_node());
+        }
+    }
+
+    bool Region_node::at(const Point &p) const {
+        switch (operation) {
+            case Region_operation::intersection:
+                return first(p) && second(p);
+            case Region_operation::sum:
+                return first(p) || second(p);
+            case Region_operation::symmetric_difference:
+                return first(p) != second(p);
+            case Region_operation::complement:
+                return !first(p);
+        }
+
+        return false;
+    }
+
+    void Region_node::evaluate(const Point_block &points, Value_block<bool> &values) const {
+        Mask all = lanes(points.size);
+        first(points, values);
+        Mask mask = values.get_mask() & all;
+
+        if (operation == Region_operation::complement) {
+            values.set_mask(~mask & all);
+            return;
+        }
+
+        if ((operation == Region_operation::intersection && mask == 0)
+            || (operation == Region_operation::sum && mask == all)) {
+            values.set_mask(mask);
+            return;
+        }
+
+        Value_block<bool> other;
+        second(points, other);
+        Mask other_mask = other.get_mask() & all;
+
+        switch (operation) {
+            case Region_operation::intersection:
+                values.set_mask(mask & other_mask);
+                break;
+            case Region_operation::sum:
+                values.set_mask(mask | other_mask);
+                break;
+            default:
+                values.set_mask(mask ^ other_mask);
+                break;
+        }
+    }
+
+    // With a constant operand the result is a constant, the other operand or its complement
+    std::shared_ptr<const Node<bool>> Region_node::optimize(Optimizer &optimizer) const {
+        Region first = optimizer(this->first);
+        Region second = optimizer(this->second);
+
+        if (optimizer.get_pass() == Optimization_pass::constant_folding) {
+            const bool *first_value = constant_value(first);
+            const bool *second_value = second ? constant_value(second) : nullptr;
+
+            if (first_value != nullptr && (operation == Region_operation::complement || second_value != nullptr)) {
+                return std::make_shared<Constant_node<bool>>(
+                        apply(operation, *first_value, second_value != nullptr && *second_value));
+            }
+
+            const bool *value = first_value != nullptr ? first_value : second_value;
+            const Region &other = first_value != nullptr ? second : first;
+
+            if (value != nullptr) {
+                switch (operation) {
+                    case Region_operation::intersection:
+                        return *value ? other.get_node() : std::make_shared<Constant_node<bool>>(false);
+                    case Region_operation::sum:
+                        return *value ? std::make_shared<Constant_node<bool>>(true) : other.get_node();
+                    default:
+                        return *value ? complement(other).get_node() : other.get_node();
+                }
+            }
+        }
+
+        if (same(first, this->first) && same(second, this->second)) {
+            return nullptr;
+        }
+
+        return std::make_shared<Region_node>(operation, first, second);
+    }
+
+    std::optional<Support<bool>> Region_node::support() const {
+        std::optional<Support<bool>> first_support = first.get_node()->support();
+        std::optional<Support<bool>> second_support = second ? second.get_node()->support()
+                                                             : Support<bool>{Bounds::empty(), false};
+
+        if (!first_support || !second_support) {
+            return std::nullopt;
+        }
+
+        return Support<bool>{first_support->bounds.unite(second_support->bounds),
+                             apply(operation, first_support->background, second_support->background)};
+    }
+
+    bool Region_node::changes_of_inputs(const Node<bool> &previous, Bounds &result) const {
+        auto node = dynamic_cast<const Region_node *>(&previous);
+
+        if (node == nullptr) {
+            return false;
+        }
+
+        result = Detail::changes(first, node->first).unite(Detail::changes(second, node->second));
+
+        return true;
+    }
+
+    Cond_node::Cond_node(const Region &region, const Image &this_way, const Image &that_way)
+            : region(region), this_way(this_way), that_way(that_way) {}
+
+    const char *Cond_node::name() const {
+        return "cond";
+    }
+
+    std::string Cond_node::signature() const {
+        return "";
+    }
+
+    void Cond_node::for_each_input(const std::function<void(const Node_base &)> &visit) const {
+        visit(*region.get_node());
+        visit(*this_way.get_node());
+        visit(*that_way.get_node());
+    }
+
+    Color Cond_node::at(const Point &p) const {
+        return region(p) ? this_way(p) : that_way(p);
+    }
+
+    void Cond_node::evaluate(const Point_block &points, Value_block<Color> &values) const {
+        Value_block<bool> inside;
+        region(points, inside);
+        Mask all = lanes(points.size);
+        Mask mask = inside.get_mask() & all;
+
+        if (mask == all) {
+            this_way(points, values);
+            return;
+        }
+
+        if (mask == 0) {
+            that_way(points, values);
+            return;
+        }
+
+        Value_block<Color> these;
+        Value_block<Color> those;
+        this_way(points, these);
+        that_way(points, those);
+
+        for (std::size_t i = 0; i < points.size; i++) {
+            values.set(i, inside[i] ? these[i] : those[i]);
+        }
+    }
+
+    // Branches are dead if the region is a constant, if they are the same image
+    // or if they are a cond on the same region, which always goes the same way as this one
+    std::shared_ptr<const Node<Color>> Cond_node::optimize(Optimizer &optimizer) const {
+        Region region = optimizer(this->region);
+        Image this_way = optimizer(this->this_way);
+        Image that_way = optimizer(this->that_way);
+
+        if (optimizer.get_pass() == Optimization_pass::dead_branches) {
+            if (const bool *value = constant_value(region)) {
+                return (*value ? this_way : that_way).get_node();
+            }
+
+            auto inner = dynamic_cast<const Cond_node *>(this_way.get_node().get());
+
+            if (inner != nullptr && same(inner->region, region)) {
+                this_way = inner->this_way;
+            }
+
+            inner = dynamic_cast<const Cond_node *>(that_way.get_node().get());
+
+            if (inner != nullptr && same(inner->region, region)) {
+                that_way = inner->that_way;
+            }
+
+            if (same(this_way, that_way)) {
+                return this_way.get_node();
+            }
+        }
+
+        if (same(region, this->region) && same(this_way, this->this_way) && same(that_way, this->that_way)) {
+            return nullptr;
+        }
+
+        return std::make_shared<Cond_node>(region, this_way, that_way);
+    }
+
+    // Outside the support of the region only one branch is used
+    std::optional<Support<Color>> Cond_node::support() const {
+        std::optional<Support<bool>> region_support = region.get_node()->support();
+
+        if (!region_support) {
+            return std::nullopt;
+        }
+
+        std::optional<Support<Color>> branch = (region_support->background ? this_way : that_way).get_node()->support();
+
+        if (!branch) {
+            return std::nullopt;
+        }
+
+        return Support<Color>{region_support->bounds.unite(branch->bounds), branch->background};
+    }
+
+    bool Cond_node::changes_of_inputs(const Node<Color> &previous, Bounds &result) const {
+        auto node = dynamic_cast<const Cond_node *>(&previous);
+
+        if (node == nullptr) {
+            return false;
+        }
+
+        // A branch matters only where either region can choose it
+        Bounds these = reach(region, true).unite(reach(node->region, true));
+        Bounds those = reach(region, false).unite(reach(node->region, false));
+        result = Detail::changes(region, node->region)
+                .unite(Detail::changes(this_way, node->this_way).intersect(these))
+                .unite(Detail::changes(that_way, node->that_way).intersect(those));
+
+        return true;
+    }
+
+    Lerp_node::Lerp_node(const Blend &blend, const Image &this_way, const Image &that_way)
+            : blend(blend), this_way(this_way), that_way(that_way) {}
+
+    const char *Lerp_node::name() const {
+        return "lerp";
+    }
+
+    std::string Lerp_node::signature() const {
+        return "";
+    }
+
+    void Lerp_node::for_each_input(const std::function<void(const Node_base &)> &visit) const {
+        visit(*blend.get_node());
+        visit(*this_way.get_node());
+        visit(*that_way.get_node());
+    }
+
+    Color Lerp_node::at(const Point &p) const {
+        return this_way(p).weighted_mean(that_way(p), blend(p));
+    }
+
+    void Lerp_node::evaluate(const Point_block &points, Value_block<Color> &values) const {
+        Value_block<Fraction> weights;
+        Value_block<Color> these;
+        Value_block<Color> those;
+        blend(points, weights);
+        this_way(points, these);
+        that_way(points, those);
+
+        for (std::size_t i = 0; i < points.size; i++) {
+            values.set(i, these[i].weighted_mean(those[i], weights[i]));
+        }
+    }
+
+    // A constant blend of 0 or 1 selects one of the images, of constants it gives a constant
+    std::shared_ptr<const Node<Color>> Lerp_node::optimize(Optimizer &optimizer) const {
+        Blend blend = optimizer(this->blend);
+        Image this_way = optimizer(this->this_way);
+        Image that_way = optimizer(this->that_way);
+
+        if (optimizer.get_pass() == Optimization_pass::constant_folding) {
+            if (const Fraction *weight = constant_value(blend)) {
+                const Color *these = constant_value(this_way);
+                const Color *those = constant_value(that_way);
+
+                if (*weight == 0) {
+                    return this_way.get_node();
+                }
+
+                if (*weight == 1) {
+                    return that_way.get_node();
+                }
+
+                if (these != nullptr && those != nullptr) {
+                    return std::make_shared<Constant_node<Color>>(these->weighted_mean(*those, *weight));
+                }
+            }
+        }
+
+        if (same(blend, this->blend) && same(this_way, this->this_way) && same(that_way, this->that_way)) {
+            return nullptr;
+        }
+
+        return std::make_shared<Lerp_node>(blend, this_way, that_way);
+    }
+
+    std::optional<Support<Color>> Lerp_node::support() const {
+        std::optional<Support<Fraction>> blend_support = blend.get_node()->support();
+        std::optional<Support<Color>> these = this_way.get_node()->support();
+        std::optional<Support<Color>> those = that_way.get_node()->support();
+
+        if (!blend_support || !these || !those) {
+            return std::nullopt;
+        }
+
+        return Support<Color>{blend_support->bounds.unite(these->bounds).unite(those->bounds),
+                              these->background.weighted_mean(those->background, blend_support->background)};
+    }
+
+    bool Lerp_node::changes_of_inputs(const Node<Color> &previous, Bounds &result) const {
+        auto node = dynamic_cast<const Lerp_node *>(&previous);
+
+        if (node == nullptr) {
+            return false;
+        }
+
+        result = Detail::changes(blend, node->blend)
+                .unite(Detail::changes(this_way, node->this_way))
+                .unite(Detail::changes(that_way, node->that_way));
+
+        return true;
+    }
+
+    Region combine(Region_operation operation, const Region &first, const Region &second) {
+        return Region(std::make_shared<Region_node>(operation, first, second));
+    }
+}
+
+Region complement(const Region &region) {
+    return Detail::combine(Detail::Region_operation::complement, region, Region());
+}
+
 Image cond(const Region &region, const Image &this_way, const Image &that_way) {
-    return [=](Point p) { return region(p) ? this_way(p) : that_way(p); };
+    return Image(std::make_shared<Detail::Cond_node>(region, this_way, that_way));
 }
 
 Image lerp(const Blend &blend, const Image &this_way, const Image &that_way) {
-    return lift(&Color::weighted_mean, this_way, that_way, blend);
+    return Image(std::make_shared<Detail::Lerp_node>(blend, this_way, that_way));
 }
 
 Image darken(const Image &image, const Blend &blend) {
@@ -4,14 +4,16 @@
 #include "coordinate.h"
 #include "color.h"
 #include "functional.h"
+#include "image_node.h"
 
 #include <functional>
 #include <cassert>
 #include <cmath>
+#include <memory>
+#include <optional>
+#include <string>
 
 using Fraction = double;
-template<typename T>
-using Base_image = std::function<T(const Point)>;
 using Region = Base_image<bool>;
 using Image = Base_image<Color>;
 using Blend = Base_image<Fraction>;
@@ -55,59 +57,643 @@ namespace Detail {
     }
 }
 
+namespace Detail {
+    template<typename T>
+    class Constant_node : public Node<T> {
+    public:
+        explicit Constant_node(const T &t) : t(t) {}
+
+        const char *name() const override {
+            return "constant";
+        }
+
+        std::string signature() const override {
+            return fields(t);
+        }
+
+        T at(const Point &) const override {
+            return t;
+        }
+
+        void evaluate(const Point_block &points, Value_block<T> &values) const override {
+            for (std::size_t i = 0; i < points.size; i++) {
+                values.set(i, t);
+            }
+        }
+
+        std::optional<Support<T>> support() const override {
+            return Support<T>{Bounds::empty(), t};
+        }
+
+        const T &get_value() const {
+            return t;
+        }
+
+    private:
+        T t;
+    };
+
+    // Value of the image if it is a constant, null otherwise
+    template<typename T>
+    const T *constant_value(const Base_image<T> &image) {
+        auto node = dynamic_cast<const Constant_node<T> *>(image.get_node().get());
+
+        return node != nullptr ? &node->get_value() : nullptr;
+    }
+
+    // Affine map of the plane, p -> (xx * x + xy * y + x0, yx * x + yy * y + y0) in cartesian coordinates.
+    // Transforms of an image map the point before it is passed to the image.
+    struct Affine {
+        double xx, xy, x0;
+        double yx, yy, y0;
+
+        static Affine rotation(double phi) {
+            double c = std::cos(phi);
+            double s = std::sin(phi);
+
+            return {c, s, 0, -s, c, 0};
+        }
+
+        static Affine translation(const Vector &vector) {
+            return {1, 0, -vector.first, 0, 1, -vector.second};
+        }
+
+        static Affine scaling(double s) {
+            return {1 / s, 0, 0, 0, 1 / s, 0};
+        }
+
+        // Map applying this one first and then the next one
+        Affine then(const Affine &next) const {
+            return {next.xx * xx + next.xy * yx, next.xx * xy + next.xy * yy, next.xx * x0 + next.xy * y0 + next.x0,
+                    next.yx * xx + next.yy * yx, next.yx * xy + next.yy * yy, next.yx * x0 + next.yy * y0 + next.y0};
+        }
+
+        Point operator()(const Point &p) const {
+            if (p.is_polar) {
+                return (*this)(from_polar(p));
+            }
+
+            return Point(xx * p.first + xy * p.second + x0, yx * p.first + yy * p.second + y0);
+        }
+
+        Affine inverse() const {
+            double determinant = xx * yy - xy * yx;
+            double ixx = yy / determinant;
+            double ixy = -xy / determinant;
+            double iyx = -yx / determinant;
+            double iyy = xx / determinant;
+
+            return {ixx, ixy, -(ixx * x0 + ixy * y0), iyx, iyy, -(iyx * x0 + iyy * y0)};
+        }
+
+        // Bounds of the points which the map takes into the bounds
+        Bounds preimage(const Bounds &bounds) const {
+            if (bounds.is_empty() || !bounds.is_bounded()) {
+                return bounds.is_empty() ? bounds : Bounds::everything();
+            }
+
+            Affine back = inverse();
+            Bounds result = Bounds::empty();
+
+            for (double x : {bounds.left, bounds.right}) {
+                for (double y : {bounds.bottom, bounds.top}) {
+                    Point p = back(Point(x, y));
+                    result = result.unite({p.first, p.second, p.first, p.second});
+                }
+            }
+
+            return result;
+        }
+
+        void operator()(Point_block &points) const {
+            points.to_cartesian();
+
+            for (std::size_t i = 0; i < points.size; i++) {
+                double x = points.first[i];
+                double y = points.second[i];
+                points.first[i] = xx * x + xy * y + x0;
+                points.second[i] = yx * x + yy * y + y0;
+            }
+        }
+    };
+
+    // Chain of rotate, translate and scale folded into one map, so that it costs
+    // a single matrix product per point and no polar conversions
+    template<typename T>
+    class Affine_node : public Node<T> {
+    public:
+        Affine_node(const Base_image<T> &image, const Affine &affine) : image(image), affine(affine) {}
+
+        const char *name() const override {
+            return "transform";
+        }
+
+        std::string signature() const override {
+            return fields(affine.xx, affine.xy, affine.x0, affine.yx, affine.yy, affine.y0);
+        }
+
+        void for_each_input(const std::function<void(const Node_base &)> &visit) const override {
+            visit(*image.get_node());
+        }
+
+        T at(const Point &p) const override {
+            return image(affine(p));
+        }
+
+        void evaluate(const Point_block &points, Value_block<T> &values) const override {
+            Point_block transformed = points;
+            affine(transformed);
+            image(transformed, values);
+        }
+
+        std::shared_ptr<const Node<T>> optimize(Optimizer &optimizer) const override;
+
+        std::optional<Support<T>> support() const override {
+            std::optional<Support<T>> inner = image.get_node()->support();
+
+            if (!inner) {
+                return std::nullopt;
+            }
+
+            return Support<T>{affine.preimage(inner->bounds), inner->background};
+        }
+
+        const Base_image<T> &get_image() const {
+            return image;
+        }
+
+        const Affine &get_affine() const {
+            return affine;
+        }
+
+    protected:
+        bool changes_of_inputs(const Node<T> &previous, Bounds &result) const override {
+            auto node = dynamic_cast<const Affine_node<T> *>(&previous);
+
+            if (node == nullptr) {
+                return false;
+            }
+
+            result = affine.preimage(Detail::changes(image, node->image));
+
+            return true;
+        }
+
+    private:
+        Base_image<T> image;
+        Affine affine;
+    };
+
+    // Transforms the image, folding the map into the transform of the image if it has one
+    template<typename T>
+    Base_image<T> transform(const Base_image<T> &image, const Affine &affine) {
+        if (auto inner = std::dynamic_pointer_cast<const Affine_node<T>>(image.get_node())) {
+            return Base_image<T>(std::make_shared<Affine_node<T>>(inner->get_image(),
+                                                                  affine.then(inner->get_affine())));
+        }
+
+        return Base_image<T>(std::make_shared<Affine_node<T>>(image, affine));
+    }
+
+    // A transformed constant is the constant
+    template<typename T>
+    std::shared_ptr<const Node<T>> Affine_node<T>::optimize(Optimizer &optimizer) const {
+        Base_image<T> optimized = optimizer(image);
+
+        if (optimizer.get_pass() == Optimization_pass::constant_folding) {
+            if (const T *value = constant_value(optimized)) {
+                return std::make_shared<Constant_node<T>>(*value);
+            }
+        }
+
+        return optimized.get_node() == image.get_node() ? nullptr : transform(optimized, affine).get_node();
+    }
+
+    // Leaf with the same value on both sides is the constant
+    template<typename T>
+    std::shared_ptr<const Node<T>> fold_leaf(Optimizer &optimizer, const T &this_way, const T &that_way) {
+        if (optimizer.get_pass() == Optimization_pass::constant_folding && same_values(this_way, that_way)) {
+            return std::make_shared<Constant_node<T>>(this_way);
+        }
+
+        return nullptr;
+    }
+
+    // Sets values to this_way where the mask is true and to that_way elsewhere
+    template<typename T>
+    void select(const bool (&mask)[BLOCK], std::size_t size, const T &this_way, const T &that_way,
+                Value_block<T> &values) {
+        for (std::size_t i = 0; i < size; i++) {
+            values.set(i, mask[i] ? this_way : that_way);
+        }
+    }
+
+    inline void select(const bool (&mask)[BLOCK], std::size_t size, bool this_way, bool that_way,
+                       Value_block<bool> &values) {
+        Mask packed = 0;
+
+        for (std::size_t i = 0; i < size; i++) {
+            packed |= Mask{mask[i]} << i;
+        }
+
+        values.set_mask(((this_way ? packed : 0) | (that_way ? ~packed : 0)) & lanes(size));
+    }
+
+    template<typename T>
+    class Circle_node : public Node<T> {
+    public:
+        Circle_node(const Point &q, double r, const T &inner, const T &outer)
+                : q(q), center(q.is_polar ? from_polar(q) : q), r(r), inner(inner), outer(outer) {}
+
+        const char *name() const override {
+            return "circle";
+        }
+
+        std::string signature() const override {
+            return fields(center.first, center.second, r, inner, outer);
+        }
+
+        std::shared_ptr<const Node<T>> optimize(Optimizer &optimizer) const override {
+            return fold_leaf(optimizer, inner, outer);
+        }
+
+        std::optional<Support<T>> support() const override {
+            return Support<T>{{center.first - r, center.second - r, center.first + r, center.second + r}, outer};
+        }
+
+        T at(const Point &p) const override {
+            return Detail::in_circle(p, q, r) ? inner : outer;
+        }
+
+        void evaluate(const Point_block &points, Value_block<T> &values) const override {
+            Point_block cartesian = points;
+            cartesian.to_cartesian();
+            bool mask[BLOCK];
+
+            for (std::size_t i = 0; i < cartesian.size; i++) {
+                double dx = cartesian.first[i] - center.first;
+                double dy = cartesian.second[i] - center.second;
+                mask[i] = std::sqrt(dx * dx + dy * dy) <= r;
+            }
+
+            select(mask, points.size, inner, outer, values);
+        }
+
+    private:
+        Point q;
+        Point center;
+        double r;
+        T inner;
+        T outer;
+    };
+
+    inline bool is_odd_checker(double first, double second, double d) {
+        return (int) (floor(first / d) + floor(second / d)) % 2 != 0;
+    }
+
+    template<typename T>
+    class Checker_node : public Node<T> {
+    public:
+        Checker_node(double d, const T &this_way, const T &that_way)
+                : d(d), this_way(this_way), that_way(that_way) {}
+
+        const char *name() const override {
+            return "checker";
+        }
+
+        std::string signature() const override {
+            return fields(d, this_way, that_way);
+        }
+
+        std::shared_ptr<const Node<T>> optimize(Optimizer &optimizer) const override {
+            return fold_leaf(optimizer, this_way, that_way);
+        }
+
+        T at(const Point &p) const override {
+            return Detail::is_this_checker(p, d) ? that_way : this_way;
+        }
+
+        void evaluate(const Point_block &points, Value_block<T> &values) const override {
+            Point_block cartesian = points;
+            cartesian.to_cartesian();
+            bool mask[BLOCK];
+
+            for (std::size_t i = 0; i < cartesian.size; i++) {
+                mask[i] = is_odd_checker(cartesian.first[i], cartesian.second[i], d);
+            }
+
+            select(mask, points.size, that_way, this_way, values);
+        }
+
+    private:
+        double d;
+        T this_way;
+        T that_way;
+    };
+
+    template<typename T>
+    class Polar_checker_node : public Node<T> {
+    public:
+        Polar_checker_node(double d, int n, const T &this_way, const T &that_way)
+                : d(d), n(n), this_way(this_way), that_way(that_way) {}
+
+        const char *name() const override {
+            return "polar_checker";
+        }
+
+        std::string signature() const override {
+            return fields(d, n, this_way, that_way);
+        }
+
+        std::shared_ptr<const Node<T>> optimize(Optimizer &optimizer) const override {
+            return fold_leaf(optimizer, this_way, that_way);
+        }
+
+        T at(const Point &p) const override {
+            return Detail::is_this_checker(Detail::convert_polar_checker(p, n, d), d) ? that_way : this_way;
+        }
+
+        void evaluate(const Point_block &points, Value_block<T> &values) const override {
+            Point_block polar = points;
+            polar.to_polar();
+            double product = double(n) * d;
+            bool mask[BLOCK];
+
+            // Rounded in the same order as convert_polar_checker, so that both paths agree on the edges
+            for (std::size_t i = 0; i < polar.size; i++) {
+                mask[i] = is_odd_checker(polar.first[i], polar.second[i] * product / (2 * M_PI), d);
+            }
+
+            select(mask, points.size, that_way, this_way, values);
+        }
+
+    private:
+        double d;
+        int n;
+        T this_way;
+        T that_way;
+    };
+
+    template<typename T>
+    class Rings_node : public Node<T> {
+    public:
+        Rings_node(const Point &q, double d, const T &this_way, const T &that_way)
+                : q(q), center(q.is_polar ? from_polar(q) : q), d(d), this_way(this_way), that_way(that_way) {}
+
+        const char *name() const override {
+            return "rings";
+        }
+
+        std::string signature() const override {
+            return fields(center.first, center.second, d, this_way, that_way);
+        }
+
+        std::shared_ptr<const Node<T>> optimize(Optimizer &optimizer) const override {
+            return fold_leaf(optimizer, this_way, that_way);
+        }
+
+        T at(const Point &p) const override {
+            return Detail::is_this_ring(p, q, d) ? this_way : that_way;
+        }
+
+        void evaluate(const Point_block &points, Value_block<T> &values) const override {
+            Point_block cartesian = points;
+            cartesian.to_cartesian();
+            bool mask[BLOCK];
+
+            for (std::size_t i = 0; i < cartesian.size; i++) {
+                double dx = cartesian.first[i] - center.first;
+                double dy = cartesian.second[i] - center.second;
+                mask[i] = (int) floor(std::sqrt(dx * dx + dy * dy) / d) % 2 == 0;
+            }
+
+            select(mask, points.size, this_way, that_way, values);
+        }
+
+    private:
+        Point q;
+        Point center;
+        double d;
+        T this_way;
+        T that_way;
+    };
+
+    template<typename T>
+    class Stripe_node : public Node<T> {
+    public:
+        Stripe_node(double d, const T &this_way, const T &that_way)
+                : d(d), this_way(this_way), that_way(that_way) {}
+
+        const char *name() const override {
+            return "vertical_stripe";
+        }
+
+        std::string signature() const override {
+            return fields(d, this_way, that_way);
+        }
+
+        std::shared_ptr<const Node<T>> optimize(Optimizer &optimizer) const override {
+            return fold_leaf(optimizer, this_way, that_way);
+        }
+
+        T at(const Point &p) const override {
+            return Detail::is_stripe(p, d) ? this_way : that_way;
+        }
+
+        void evaluate(const Point_block &points, Value_block<T> &values) const override {
+            Point_block cartesian = points;
+            cartesian.to_cartesian();
+            bool mask[BLOCK];
+
+            for (std::size_t i = 0; i < cartesian.size; i++) {
+                mask[i] = std::abs(cartesian.first[i]) <= d / 2;
+            }
+
+            select(mask, points.size, this_way, that_way, values);
+        }
+
+    private:
+        double d;
+        T this_way;
+        T that_way;
+    };
+
+    enum class Region_operation {
+        intersection,
+        sum,
+        symmetric_difference,
+        complement
+    };
+
+    // Regions combined word by word, the second region is skipped where the first decides the result
+    class Region_node : public Node<bool> {
+    public:
+        Region_node(Region_operation operation, const Region &first, const Region &second);
+
+        const char *name() const override;
+
+        std::string signature() const override;
+
+        void for_each_input(const std::function<void(const Node_base &)> &visit) const override;
+
+        bool at(const Point &p) const override;
+
+        void evaluate(const Point_block &points, Value_block<bool> &values) const override;
+
+        std::shared_ptr<const Node<bool>> optimize(Optimizer &optimizer) const override;
+
+        std::optional<Support<bool>> support() const override;
+
+    protected:
+        bool changes_of_inputs(const Node<bool> &previous, Bounds &result) const override;
+
+    private:
+        Region_operation operation;
+        Region first;
+        Region second;
+    };
+
+    class Cond_node : public Node<Color> {
+    public:
+        Cond_node(const Region &region, const Image &this_way, const Image &that_way);
+
+        const char *name() const override;
+
+        std::string signature() const override;
+
+        void for_each_input(const std::function<void(const Node_base &)> &visit) const override;
+
+        Color at(const Point &p) const override;
+
+        void evaluate(const Point_block &points, Value_block<Color> &values) const override;
+
+        std::shared_ptr<const Node<Color>> optimize(Optimizer &optimizer) const override;
+
+        std::optional<Support<Color>> support() const override;
+
+        const Region &get_region() const {
+            return region;
+        }
+
+        const Image &get_this_way() const {
+            return this_way;
+        }
+
+        const Image &get_that_way() const {
+            return that_way;
+        }
+
+    protected:
+        bool changes_of_inputs(const Node<Color> &previous, Bounds &result) const override;
+
+    private:
+        Region region;
+        Image this_way;
+        Image that_way;
+    };
+
+    class Lerp_node : public Node<Color> {
+    public:
+        Lerp_node(const Blend &blend, const Image &this_way, const Image &that_way);
+
+        const char *name() const override;
+
+        std::string signature() const override;
+
+        void for_each_input(const std::function<void(const Node_base &)> &visit) const override;
+
+        Color at(const Point &p) const override;
+
+        void evaluate(const Point_block &points, Value_block<Color> &values) const override;
+
+        std::shared_ptr<const Node<Color>> optimize(Optimizer &optimizer) const override;
+
+        std::optional<Support<Color>> support() const override;
+
+    protected:
+        bool changes_of_inputs(const Node<Color> &previous, Bounds &result) const override;
+
+    private:
+        Blend blend;
+        Image this_way;
+        Image that_way;
+    };
+}
+
 template<typename T>
 Base_image<T> constant(const T &t) {
-    return [=](Point) { return t; };
+    return Base_image<T>(std::make_shared<Detail::Constant_node<T>>(t));
 }
 
 template<typename T>
 Base_image<T> rotate(const Base_image<T> &baseImage, double phi) {
-    return [=](Point p) { return compose(Detail::rotate, baseImage)(p, phi); };
+    return Detail::transform(baseImage, Detail::Affine::rotation(phi));
 }
 
 template<typename T>
 Base_image<T> translate(const Base_image<T> &baseImage, const Vector &vector) {
-    return [=](Point p) { return compose(Detail::add, baseImage)(p, vector); };
+    return Detail::transform(baseImage, Detail::Affine::translation(vector));
 }
 
 template<typename T>
 Base_image<T> scale(const Base_image<T> &baseImage, double s) {
     assert(s != 0);
 
-    return [=](Point p) { return compose(Detail::scale, baseImage)(p, s); };
+    return Detail::transform(baseImage, Detail::Affine::scaling(s));
 }
 
 template<typename T>
 Base_image<T> circle(const Point &q, double r, const T &inner, const T &outer) {
-    return [=](Point p) { return Detail::in_circle(p, q, r) ? inner : outer; };
+    return Base_image<T>(std::make_shared<Detail::Circle_node<T>>(q, r, inner, outer));
 }
 
 template<typename T>
 Base_image<T> checker(double d, const T &this_way, const T &that_way) {
     assert(d != 0);
 
-    return [=](Point p) { return Detail::is_this_checker(p, d) ? that_way : this_way; };
+    return Base_image<T>(std::make_shared<Detail::Checker_node<T>>(d, this_way, that_way));
 }
 
 template<typename T>
 Base_image<T> polar_checker(double d, int n, const T &this_way, const T &that_way) {
     assert(d != 0);
 
-    return [=](Point p) {
-        return compose(Detail::convert_polar_checker, checker(d, this_way, that_way))(p, n, d);
-    };
+    return Base_image<T>(std::make_shared<Detail::Polar_checker_node<T>>(d, n, this_way, that_way));
 }
 
 template<typename T>
 Base_image<T> rings(const Point &q, double d, const T &this_way, const T &that_way) {
-    return [=](Point p) { return Detail::is_this_ring(p, q, d) ? this_way : that_way; };
+    return Base_image<T>(std::make_shared<Detail::Rings_node<T>>(q, d, this_way, that_way));
 }
 
 template<typename T>
 Base_image<T> vertical_stripe(double d, const T &this_way, const T &that_way) {
-    return [=](Point p) { return Detail::is_stripe(p, d) ? this_way : that_way; };
+    return Base_image<T>(std::make_shared<Detail::Stripe_node<T>>(d, this_way, that_way));
 }
 
+namespace Detail {
+    Region combine(Region_operation operation, const Region &first, const Region &second);
+}
+
+// Both operands of the region operators must be regions, callables are not converted to them
+template<typename R, typename = std::enable_if_t<std::is_same<R, Region>::value>>
+Region operator&(const R &first, const R &second) {
+    return Detail::combine(Detail::Region_operation::intersection, first, second);
+}
+
+template<typename R, typename = std::enable_if_t<std::is_same<R, Region>::value>>
+Region operator|(const R &first, const R &second) {
+    return Detail::combine(Detail::Region_operation::sum, first, second);
+}
+
+template<typename R, typename = std::enable_if_t<std::is_same<R, Region>::value>>
+Region operator^(const R &first, const R &second) {
+    return Detail::combine(Detail::Region_operation::symmetric_difference, first, second);
+}
+
+// Not operator!, which would hide the test whether a region has a node
+Region complement(const Region &region);
+
 Image cond(const Region &region, const Image &this_way, const Image &that_way);
 
 Image lerp(const Blend &blend, const Image &this_way, const Image &that_way);
@@ -0,0 +1,34 @@
+#include "optimize.h"
+
+#include <unordered_set>
+
+const char *pass_name(Optimization_pass pass) {
+    switch (pass) {
+        case Optimization_pass::constant_folding:
+            return "constant folding";
+        case Optimization_pass::common_subexpressions:
+            return "common subexpressions";
+        case Optimization_pass::dead_branches:
+            return "dead branches";
+    }
+
+    return "";
+}
+
+std::size_t count_nodes(const Node_base &node) {
+    std::unordered_set<const Node_base *> seen;
+    std::vector<const Node_base *> stack = {&node};
+
+    while (!stack.empty()) {
+        const Node_base *current = stack.back();
+        stack.pop_back();
+
+        if (seen.insert(current).second) {
+            current->for_each_input([&](const Node_base &input) {
+                stack.push_back(&input);
+            });
+        }
+    }
+
+    return seen.size();
+}
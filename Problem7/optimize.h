@@ -0,0 +1,43 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include "images.h"
+
+#include <cstddef>
+#include <vector>
+
+struct Pass_report {
+    Optimization_pass pass;
+
+    // Number of nodes of the graph the pass removed
+    std::size_t removed;
+};
+
+const char *pass_name(Optimization_pass pass);
+
+// Number of distinct nodes of the graph
+std::size_t count_nodes(const Node_base &node);
+
+// Simplifies the graph of the image before rendering, in order: constant folding, sharing of equal
+// subgraphs and elimination of dead branches of cond. Each pass runs once over the graph,
+// the passes done are appended to the report if it is given.
+template<typename T>
+Base_image<T> optimize(const Base_image<T> &image, std::vector<Pass_report> *report = nullptr) {
+    Base_image<T> result = image;
+
+    for (Optimization_pass pass : {Optimization_pass::constant_folding, Optimization_pass::common_subexpressions,
+                                   Optimization_pass::dead_branches}) {
+        std::size_t before = count_nodes(*result.get_node());
+        Optimizer optimizer(pass);
+        result = optimizer(result);
+
+        if (report != nullptr) {
+            std::size_t after = count_nodes(*result.get_node());
+            report->push_back({pass, before > after ? before - after : 0});
+        }
+    }
+
+    return result;
+}
+
+#endif //OPTIMIZE_H
@@ -0,0 +1,164 @@
+#include "profile.h"
+#include "image_node.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <utility>
+
+// Evaluations of nodes with the same name on the same path. The name is copied,
+// so that the profile can be reported after the image is destroyed.
+class Profile_context {
+public:
+    Profile_context(std::string name, Profile_context *parent) : name(std::move(name)), parent(parent) {}
+
+    std::string name;
+    Profile_context *parent;
+    std::size_t calls = 0;
+    std::size_t points = 0;
+    std::size_t sampled_calls = 0;
+    std::chrono::nanoseconds sampled_time{0};
+    std::vector<std::unique_ptr<Profile_context>> children;
+
+    Profile_context *child(const char *input) {
+        for (const auto &context : children) {
+            if (context->name == input) {
+                return context.get();
+            }
+        }
+
+        children.push_back(std::make_unique<Profile_context>(input, this));
+
+        return children.back().get();
+    }
+
+    // Time of all calls estimated from the sampled ones, in microseconds
+    double time() const {
+        return sampled_calls == 0 ? 0 : double(sampled_time.count()) / 1000 * double(calls) / double(sampled_calls);
+    }
+
+    double self_time() const {
+        double inputs = 0;
+
+        for (const auto &context : children) {
+            inputs += context->time();
+        }
+
+        return std::max(time() - inputs, 0.0);
+    }
+};
+
+namespace {
+    std::atomic<unsigned long> next_id{1};
+
+    // Path being evaluated by this thread, for the profiler with the given id
+    struct Thread_state {
+        unsigned long profiler = 0;
+        Profile_context *current = nullptr;
+    };
+
+    thread_local Thread_state state;
+
+    void fold(const Profile_context &context, const std::string &path, std::map<std::string, double> &stacks) {
+        for (const auto &child : context.children) {
+            std::string stack = path.empty() ? child->name : path + ';' + child->name;
+            stacks[stack] += child->self_time();
+            fold(*child, stack, stacks);
+        }
+    }
+
+    struct Totals {
+        std::size_t calls = 0;
+        std::size_t points = 0;
+        double time = 0;
+    };
+
+    void sum(const Profile_context &context, std::map<std::string, Totals> &totals) {
+        for (const auto &child : context.children) {
+            Totals &node = totals[child->name];
+            node.calls += child->calls;
+            node.points += child->points;
+            node.time += child->self_time();
+            sum(*child, totals);
+        }
+    }
+}
+
+std::atomic<Profiler *> Profiler::active{nullptr};
+
+Profiler::Profiler(std::size_t sample_period) : sample_period(std::max<std::size_t>(sample_period, 1)),
+                                                id(next_id++) {}
+
+Profiler::~Profiler() {
+    stop();
+}
+
+void Profiler::start() {
+    active = this;
+}
+
+void Profiler::stop() {
+    Profiler *expected = this;
+    active.compare_exchange_strong(expected, nullptr);
+}
+
+Profile_context *Profiler::thread_root() {
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(std::make_unique<Profile_context>("", nullptr));
+
+    return threads.back().get();
+}
+
+void Profiler::write_flame_graph(std::ostream &os) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, double> stacks;
+
+    for (const auto &root : threads) {
+        fold(*root, "", stacks);
+    }
+
+    for (const auto &stack : stacks) {
+        os << stack.first << ' ' << std::llround(stack.second) << '\n';
+    }
+}
+
+void Profiler::write_summary(std::ostream &os) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, Totals> totals;
+
+    for (const auto &root : threads) {
+        sum(*root, totals);
+    }
+
+    for (const auto &node : totals) {
+        os << node.first << ": " << node.second.calls << " calls, " << node.second.points << " points, "
+           << std::llround(node.second.time) << " us\n";
+    }
+}
+
+void Profile_scope::enter(Profiler &profiler, const Node_base &node, std::size_t points) {
+    if (state.profiler != profiler.id || state.current == nullptr) {
+        state.profiler = profiler.id;
+        state.current = profiler.thread_root();
+    }
+
+    context = state.current->child(node.name());
+    context->calls++;
+    context->points += points;
+    state.current = context;
+
+    if (context->calls % profiler.sample_period == 0) {
+        timed = true;
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+void Profile_scope::leave() {
+    if (timed) {
+        context->sampled_time += std::chrono::steady_clock::now() - start;
+        context->sampled_calls++;
+    }
+
+    state.current = context->parent;
+}
@@ -0,0 +1,87 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+class Node_base;
+
+class Profile_context;
+
+// Counts evaluations of image nodes and measures their time, separately for every path of names of nodes
+// from the rendered image. Reports do not refer to the nodes, they can be written after the images
+// are destroyed. Nodes are measured only in programs built with IMAGES_PROFILING defined,
+// without it profiling adds nothing to evaluation. Time is measured for one call in sample_period
+// calls of each node and scaled up to all of them.
+class Profiler {
+public:
+    explicit Profiler(std::size_t sample_period = 8);
+
+    Profiler(const Profiler &that) = delete;
+
+    Profiler &operator=(const Profiler &rhs) = delete;
+
+    ~Profiler();
+
+    // Evaluations in all threads are measured by this profiler until it is stopped
+    void start();
+
+    void stop();
+
+    // Writes the profile in the folded stacks format read by flame graph tools: names of the nodes
+    // on a path from the image joined by semicolons and the time of the last one in microseconds,
+    // excluding its inputs. Reports are written when no image is being evaluated.
+    void write_flame_graph(std::ostream &os) const;
+
+    // Writes evaluations, points and time excluding inputs for every combinator
+    void write_summary(std::ostream &os) const;
+
+private:
+    friend class Profile_scope;
+
+    std::size_t sample_period;
+    unsigned long id;
+    mutable std::mutex mutex;
+    // Root of the paths of every thread which evaluated an image
+    std::vector<std::unique_ptr<Profile_context>> threads;
+
+    static std::atomic<Profiler *> active;
+
+    Profile_context *thread_root();
+};
+
+// Measures the evaluation of a node while it lasts
+class Profile_scope {
+public:
+    Profile_scope(const Node_base &node, std::size_t points) {
+        if (Profiler *profiler = Profiler::active.load(std::memory_order_relaxed)) {
+            enter(*profiler, node, points);
+        }
+    }
+
+    Profile_scope(const Profile_scope &that) = delete;
+
+    Profile_scope &operator=(const Profile_scope &rhs) = delete;
+
+    ~Profile_scope() {
+        if (context != nullptr) {
+            leave();
+        }
+    }
+
+private:
+    Profile_context *context = nullptr;
+    bool timed = false;
+    std::chrono::steady_clock::time_point start;
+
+    void enter(Profiler &profiler, const Node_base &node, std::size_t points);
+
+    void leave();
+};
+
+#endif //PROFILE_H
@@ -0,0 +1,102 @@
+// Rendering speed of a scene in megapixels per second without a profiler and with one started, per point
+// and in blocks, on one thread. Build it twice, with and without IMAGES_PROFILING, to compare disabled
+// profiling with none compiled in.
+// Build: g++ -std=c++17 -O2 -pthread [-DIMAGES_PROFILING] profile_benchmark.cc images.cc render.cc profile.cc
+//        -o profile_benchmark
+#include "render.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    const std::size_t WIDTH = 640;
+    const std::size_t HEIGHT = 480;
+    const std::size_t REPEATS = 5;
+
+    Image scene() {
+        Image background = lerp(rotate(circle(Point(50, 0), 150.0, 0.8, 0.2), 0.3),
+                                rings(Point(0, 0), 12.0, Colors::red, Colors::blue),
+                                scale(checker(8.0, Colors::white, Colors::caramel), 2.0));
+
+        return cond(circle(Point(0, 0), 200.0, true, false) ^ vertical_stripe(60.0, true, false),
+                    polar_checker(10.0, 12, Colors::green, Colors::caramel), darken(background, constant(0.3)));
+    }
+
+    // Renders the image by calling it at every pixel, like render places pixels
+    void render_points(const Image &image, unsigned char *buffer) {
+        for (std::size_t y = 0; y < HEIGHT; y++) {
+            for (std::size_t x = 0; x < WIDTH; x++) {
+                Color color = image(Point(double(x) - double(WIDTH) / 2, double(HEIGHT) / 2 - double(y)));
+                unsigned char *pixel = buffer + 3 * (y * WIDTH + x);
+                pixel[0] = color.red;
+                pixel[1] = color.green;
+                pixel[2] = color.blue;
+            }
+        }
+    }
+
+    // Megapixels per second of the best of the repeats
+    template<typename Render>
+    double speed(Render render) {
+        double best = 0;
+
+        for (std::size_t repeat = 0; repeat < REPEATS; repeat++) {
+            auto begin = std::chrono::steady_clock::now();
+            render();
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            best = repeat == 0 ? time : std::min(best, time);
+        }
+
+        return WIDTH * HEIGHT / best / 1e6;
+    }
+}
+
+int main() {
+    Image image = scene();
+    std::vector<unsigned char> expected(3 * WIDTH * HEIGHT), pixels(3 * WIDTH * HEIGHT);
+    Render_options options;
+    options.threads = 1;
+    render(image, WIDTH, HEIGHT, expected.data(), options);
+
+#ifdef IMAGES_PROFILING
+    std::cout << "built with IMAGES_PROFILING\n";
+#else
+    std::cout << "built without IMAGES_PROFILING\n";
+#endif
+    std::cout << std::left << std::setw(20) << "profiler" << std::right << std::setw(12) << "points"
+              << std::setw(12) << "blocks" << "  (Mpixel/s)\n";
+
+    // No sample period means no profiler
+    for (std::size_t sample_period : {0, 1, 8, 64}) {
+        Profiler profiler(sample_period);
+
+        if (sample_period > 0) {
+            profiler.start();
+        }
+
+        double points = speed([&] {
+            render_points(image, pixels.data());
+        });
+
+        double blocks = speed([&] {
+            render(image, WIDTH, HEIGHT, pixels.data(), options);
+        });
+
+        profiler.stop();
+
+        if (pixels != expected) {
+            std::cout << "profiled image differs\n";
+            return EXIT_FAILURE;
+        }
+
+        std::string name = sample_period == 0 ? "none" : "every " + std::to_string(sample_period) + " calls";
+        std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << points << std::setw(12) << blocks << '\n';
+    }
+}
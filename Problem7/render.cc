@@ -0,0 +1,392 @@
+#include "render.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+namespace {
+    // Evaluates the image at count points in blocks, position(i, x, y) gives the coordinates
+    // of the point i and store(i, color) receives its color, both are called with i in increasing order
+    template<typename Position, typename Store>
+    void evaluate_points(const Image &image, std::size_t count, Position position, Store store) {
+        Point_block points;
+        Value_block<Color> colors;
+
+        for (std::size_t begin = 0; begin < count; begin += BLOCK) {
+            points.size = std::min(BLOCK, count - begin);
+            points.is_polar = false;
+
+            for (std::size_t i = 0; i < points.size; i++) {
+                position(begin + i, points.first[i], points.second[i]);
+            }
+
+            image(points, colors);
+
+            for (std::size_t i = 0; i < points.size; i++) {
+                store(begin + i, colors[i]);
+            }
+        }
+    }
+
+    void store_color(unsigned char *pixel, const Color &color) {
+        pixel[0] = static_cast<unsigned char>(color.red);
+        pixel[1] = static_cast<unsigned char>(color.green);
+        pixel[2] = static_cast<unsigned char>(color.blue);
+    }
+
+    // Renders pixels from left to right (exclusive) of rows from top to bottom (exclusive),
+    // the buffer starts at the row first_row of the frame
+    void render_tile(const Image &image, std::size_t width, std::size_t height, unsigned char *buffer,
+                     std::size_t first_row, std::size_t left, std::size_t top, std::size_t right, std::size_t bottom) {
+        for (std::size_t y = top; y < bottom; y++) {
+            unsigned char *row = buffer + 3 * ((y - first_row) * width + left);
+
+            evaluate_points(image, right - left, [&](std::size_t i, double &first, double &second) {
+                first = double(left + i) - double(width) / 2;
+                second = double(height) / 2 - double(y);
+            }, [&](std::size_t i, const Color &color) {
+                store_color(row + 3 * i, color);
+            });
+        }
+    }
+
+    // Renders the tile with samples * samples points per pixel. In the adaptive mode every pixel
+    // and its neighbours are first sampled once at the centre, and only pixels whose colour
+    // differs from any of the four neighbours are sampled again.
+    void render_antialiased_tile(const Image &image, std::size_t width, std::size_t height, unsigned char *buffer,
+                                 std::size_t first_row, std::size_t left, std::size_t top, std::size_t right,
+                                 std::size_t bottom, std::size_t samples, bool adaptive) {
+        std::size_t tile_width = right - left;
+        std::size_t tile_height = bottom - top;
+        std::vector<std::size_t> edges;
+
+        auto pixel = [&](std::size_t i) {
+            return buffer + 3 * ((top + i / tile_width - first_row) * width + left + i % tile_width);
+        };
+
+        if (adaptive) {
+            // Colours of the centres packed into words, to compare neighbours at once
+            std::size_t stride = tile_width + 2;
+            std::vector<uint32_t> centres(stride * (tile_height + 2));
+            // Points are taken in order, so the position is advanced instead of divided out of the index
+            std::size_t x = 0;
+            std::size_t y = 0;
+
+            evaluate_points(image, centres.size(), [&](std::size_t, double &first, double &second) {
+                first = double(left + x) - 1 - double(width) / 2;
+                second = double(height) / 2 - (double(top + y) - 1);
+
+                if (++x == stride) {
+                    x = 0;
+                    y++;
+                }
+            }, [&](std::size_t i, const Color &color) {
+                centres[i] = uint32_t(static_cast<unsigned char>(color.red))
+                             | uint32_t(static_cast<unsigned char>(color.green)) << 8
+                             | uint32_t(static_cast<unsigned char>(color.blue)) << 16;
+            });
+
+            for (y = 0; y < tile_height; y++) {
+                unsigned char *row = buffer + 3 * ((top + y - first_row) * width + left);
+
+                for (x = 0; x < tile_width; x++) {
+                    const uint32_t *centre = &centres[(y + 1) * stride + x + 1];
+
+                    if (*centre != centre[-1] || *centre != centre[1] || *centre != centre[-std::ptrdiff_t(stride)]
+                        || *centre != centre[stride]) {
+                        edges.push_back(y * tile_width + x);
+                    } else {
+                        row[3 * x] = static_cast<unsigned char>(*centre);
+                        row[3 * x + 1] = static_cast<unsigned char>(*centre >> 8);
+                        row[3 * x + 2] = static_cast<unsigned char>(*centre >> 16);
+                    }
+                }
+            }
+        } else {
+            for (std::size_t i = 0; i < tile_width * tile_height; i++) {
+                edges.push_back(i);
+            }
+        }
+
+        std::size_t per_pixel = samples * samples;
+        std::vector<unsigned> sums(3 * edges.size());
+
+        evaluate_points(image, edges.size() * per_pixel, [&](std::size_t i, double &first, double &second) {
+            std::size_t edge = edges[i / per_pixel];
+            std::size_t sample = i % per_pixel;
+            first = double(left + edge % tile_width) - double(width) / 2
+                    + (double(sample % samples) + 0.5) / double(samples) - 0.5;
+            second = double(height) / 2 - double(top + edge / tile_width)
+                     - (double(sample / samples) + 0.5) / double(samples) + 0.5;
+        }, [&](std::size_t i, const Color &color) {
+            unsigned *sum = &sums[3 * (i / per_pixel)];
+            sum[0] += static_cast<unsigned char>(color.red);
+            sum[1] += static_cast<unsigned char>(color.green);
+            sum[2] += static_cast<unsigned char>(color.blue);
+        });
+
+        for (std::size_t i = 0; i < edges.size(); i++) {
+            for (std::size_t k = 0; k < 3; k++) {
+                pixel(edges[i])[k] = static_cast<unsigned char>((sums[3 * i + k] + per_pixel / 2) / per_pixel);
+            }
+        }
+    }
+
+    // Tiles left to one thread, the owner takes them from the front and thieves from the back
+    class Tile_range {
+    public:
+        void assign(std::size_t begin, std::size_t end) {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->begin = begin;
+            this->end = end;
+        }
+
+        bool pop(std::size_t &tile) {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (begin == end) {
+                return false;
+            }
+
+            tile = begin++;
+
+            return true;
+        }
+
+        // Takes the back half of the tiles, rounded up
+        bool steal(std::size_t &stolen_begin, std::size_t &stolen_end) {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (begin == end) {
+                return false;
+            }
+
+            stolen_end = end;
+            end -= (end - begin + 1) / 2;
+            stolen_begin = end;
+
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    class Tiled_render {
+    public:
+        // Renders the tiles with the given numbers, counted row by row, or all of them if there are none
+        Tiled_render(const Image &image, std::size_t width, std::size_t height, std::size_t top, std::size_t bottom,
+                     unsigned char *buffer, const Render_options &options, std::vector<std::size_t> selected = {})
+                : image(image), width(width), height(height), top(top), bottom(bottom), buffer(buffer),
+                  options(options), columns((width + options.tile_size - 1) / options.tile_size),
+                  selected(std::move(selected)) {
+            if (this->selected.empty()) {
+                for (std::size_t i = 0; i < columns * ((bottom - top + options.tile_size - 1) / options.tile_size); i++) {
+                    this->selected.push_back(i);
+                }
+            }
+
+            tiles = this->selected.size();
+            ranges = std::vector<Tile_range>(std::max<std::size_t>(std::min(options.threads, tiles), 1));
+
+            for (std::size_t i = 0; i < ranges.size(); i++) {
+                ranges[i].assign(tiles * i / ranges.size(), tiles * (i + 1) / ranges.size());
+            }
+        }
+
+        bool run() {
+            std::vector<std::thread> workers;
+
+            workers.reserve(ranges.size());
+
+            for (std::size_t i = 1; i < ranges.size(); i++) {
+                try {
+                    workers.emplace_back([this, i] { work(i); });
+                } catch (const std::system_error &) {
+                    // Tiles of the threads which could not be started are stolen by the others
+                    break;
+                }
+            }
+
+            work(0);
+
+            for (std::thread &worker : workers) {
+                worker.join();
+            }
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+
+            return !cancelled();
+        }
+
+    private:
+        const Image &image;
+        std::size_t width;
+        std::size_t height;
+        std::size_t top;
+        std::size_t bottom;
+        unsigned char *buffer;
+        const Render_options &options;
+        std::size_t columns;
+        std::vector<std::size_t> selected;
+        std::size_t tiles;
+        std::vector<Tile_range> ranges;
+        std::mutex progress_mutex;
+        std::size_t finished = 0;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+
+        bool cancelled() const {
+            return options.cancel != nullptr && options.cancel->load(std::memory_order_relaxed);
+        }
+
+        void work(std::size_t index) {
+            std::size_t tile;
+
+            while (!failed.load(std::memory_order_relaxed) && !cancelled()
+                   && (ranges[index].pop(tile) || steal(index, tile))) {
+                tile = selected[tile];
+
+                try {
+                    std::size_t left = tile % columns * options.tile_size;
+                    std::size_t first = top + tile / columns * options.tile_size;
+                    std::size_t right = std::min(left + options.tile_size, width);
+                    std::size_t last = std::min(first + options.tile_size, bottom);
+
+                    if (options.samples > 1) {
+                        render_antialiased_tile(image, width, height, buffer, top, left, first, right, last,
+                                                options.samples, options.adaptive);
+                    } else {
+                        render_tile(image, width, height, buffer, top, left, first, right, last);
+                    }
+                    report();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(progress_mutex);
+
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+
+                    failed = true;
+                }
+            }
+        }
+
+        // Moves half of the tiles of another thread to this one and takes the first of them
+        bool steal(std::size_t index, std::size_t &tile) {
+            for (std::size_t i = 1; i < ranges.size(); i++) {
+                std::size_t begin;
+                std::size_t end;
+
+                if (ranges[(index + i) % ranges.size()].steal(begin, end)) {
+                    ranges[index].assign(begin + 1, end);
+                    tile = begin;
+
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void report() {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            finished++;
+
+            if (options.progress) {
+                options.progress(finished, tiles);
+            }
+        }
+    };
+}
+
+void render_mask(const Region &region, std::size_t width, std::size_t height, Mask *mask) {
+    Point_block points;
+    Value_block<bool> inside;
+
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x += BLOCK, mask++) {
+            points.size = std::min(BLOCK, width - x);
+            points.is_polar = false;
+
+            for (std::size_t i = 0; i < points.size; i++) {
+                points.first[i] = double(x + i) - double(width) / 2;
+                points.second[i] = double(height) / 2 - double(y);
+            }
+
+            region(points, inside);
+            *mask = inside.get_mask() & lanes(points.size);
+        }
+    }
+}
+
+bool render(const Image &image, std::size_t width, std::size_t height, unsigned char *buffer,
+            const Render_options &options) {
+    return render(image, width, height, 0, height, buffer, options);
+}
+
+bool render(const Image &image, std::size_t width, std::size_t height, std::size_t top, std::size_t bottom,
+            unsigned char *buffer, const Render_options &options) {
+    assert(options.tile_size > 0 && top <= bottom && bottom <= height);
+
+    return Tiled_render(image, width, height, top, bottom, buffer, options).run();
+}
+
+Incremental_renderer::Incremental_renderer(std::size_t width, std::size_t height, const Render_options &options)
+        : width(width), height(height), options(options), frame(3 * width * height) {}
+
+bool Incremental_renderer::render(const Image &image) {
+    assert(options.tile_size > 0);
+
+    std::vector<std::size_t> tiles;
+    std::size_t columns = (width + options.tile_size - 1) / options.tile_size;
+    std::size_t rows = (height + options.tile_size - 1) / options.tile_size;
+    Bounds changed = previous ? Detail::changes(image, previous) : Bounds::everything();
+
+    if (!changed.is_empty()) {
+        // Pixels whose samples can fall into the bounds, anti-aliasing looks one pixel further
+        double margin = 2;
+        auto clamp = [](double value, std::size_t size) {
+            return std::size_t(std::min(std::max(value, 0.0), double(size)));
+        };
+        std::size_t left = clamp(std::floor(changed.left + double(width) / 2 - margin), width);
+        std::size_t right = clamp(std::ceil(changed.right + double(width) / 2 + margin) + 1, width);
+        std::size_t top = clamp(std::floor(double(height) / 2 - changed.top - margin), height);
+        std::size_t bottom = clamp(std::ceil(double(height) / 2 - changed.bottom + margin) + 1, height);
+
+        for (std::size_t row = top / options.tile_size; row * options.tile_size < bottom && row < rows; row++) {
+            for (std::size_t column = left / options.tile_size;
+                 column * options.tile_size < right && column < columns; column++) {
+                tiles.push_back(row * columns + column);
+            }
+        }
+    }
+
+    rendered_tiles = tiles.size();
+
+    if (tiles.empty()) {
+        previous = image;
+
+        return true;
+    }
+
+    bool finished = Tiled_render(image, width, height, 0, height, frame.data(), options, std::move(tiles)).run();
+    previous = finished ? image : Image();
+
+    return finished;
+}
+
+const unsigned char *Incremental_renderer::get_frame() const {
+    return frame.data();
+}
+
+std::size_t Incremental_renderer::get_rendered_tiles() const {
+    return rendered_tiles;
+}
@@ -0,0 +1,77 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "images.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+struct Render_options {
+    // Number of rendering threads, at least one
+    std::size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // Width and height of tiles the frame is split into
+    std::size_t tile_size = 64;
+
+    // Called after each finished tile with the numbers of finished and all tiles,
+    // calls are serialized but can come from any rendering thread
+    std::function<void(std::size_t, std::size_t)> progress;
+
+    // Anti-aliasing: pixels are averaged over samples * samples points spread evenly over them.
+    // In the adaptive mode only pixels whose single sample differs from a neighbour are refined.
+    std::size_t samples = 1;
+
+    bool adaptive = true;
+
+    // Rendering stops early once the flag is set
+    const std::atomic<bool> *cancel = nullptr;
+};
+
+// Renders the image into the buffer of width * height pixels, three bytes (red, green, blue)
+// per pixel, rows from the top. Pixel (x, y) shows the point (x - width / 2, height / 2 - y).
+// Images are evaluated in blocks of points with the batched kernels of their nodes.
+// The frame is split into tiles rendered in parallel, threads which run out of tiles steal them
+// from the others. Images must be safe to evaluate from many threads, which holds for all combinators
+// and for functions without side effects. Returns false if rendering was cancelled.
+bool render(const Image &image, std::size_t width, std::size_t height, unsigned char *buffer,
+            const Render_options &options = Render_options());
+
+// Renders only the rows from top to bottom (exclusive) of the frame, the buffer holds just these rows
+bool render(const Image &image, std::size_t width, std::size_t height, std::size_t top, std::size_t bottom,
+            unsigned char *buffer, const Render_options &options = Render_options());
+
+// Evaluates the region at the same points as render and packs the results into the mask,
+// 64 pixels per word starting from the lowest bit, each row starting a new word
+void render_mask(const Region &region, std::size_t width, std::size_t height, Mask *mask);
+
+// Renders frames of an animation into its own buffer. Only tiles where the image can differ from the image
+// of the previous frame are rendered again, as found by comparing their graphs. Parts of the scene which
+// do not change should be the same Base_image objects in all frames, images made by the same combinators
+// with the same parameters are also recognized, other images are assumed to differ inside their supports.
+class Incremental_renderer {
+public:
+    Incremental_renderer(std::size_t width, std::size_t height, const Render_options &options = Render_options());
+
+    // Returns false if rendering was cancelled, the next frame is then rendered whole
+    bool render(const Image &image);
+
+    // Pixels of the last frame, as written by render
+    const unsigned char *get_frame() const;
+
+    // Number of tiles rendered for the last frame
+    std::size_t get_rendered_tiles() const;
+
+private:
+    std::size_t width;
+    std::size_t height;
+    Render_options options;
+    std::vector<unsigned char> frame;
+    Image previous;
+    std::size_t rendered_tiles = 0;
+};
+
+#endif //RENDER_H
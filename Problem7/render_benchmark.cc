@@ -0,0 +1,183 @@
+// Rendering speed in megapixels per second of scenes evaluated one point at a time, as images were
+// evaluated when they were std::functions, and in blocks of points by render, on one thread.
+// Build: g++ -std=c++17 -O2 -pthread render_benchmark.cc images.cc render.cc profile.cc -o render_benchmark
+#include "render.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    const std::size_t WIDTH = 1024;
+    const std::size_t HEIGHT = 768;
+    const std::size_t REPEATS = 3;
+
+    // Combinators as they were defined before images became graphs of nodes
+    namespace Erased {
+        template<typename T>
+        using Base_image = std::function<T(const Point)>;
+
+        template<typename T>
+        Base_image<T> constant(const T &t) {
+            return [=](Point) { return t; };
+        }
+
+        template<typename T>
+        Base_image<T> rotate(const Base_image<T> &baseImage, double phi) {
+            return [=](Point p) { return compose(Detail::rotate, baseImage)(p, phi); };
+        }
+
+        template<typename T>
+        Base_image<T> translate(const Base_image<T> &baseImage, const Vector &vector) {
+            return [=](Point p) { return compose(Detail::add, baseImage)(p, vector); };
+        }
+
+        template<typename T>
+        Base_image<T> scale(const Base_image<T> &baseImage, double s) {
+            return [=](Point p) { return compose(Detail::scale, baseImage)(p, s); };
+        }
+
+        template<typename T>
+        Base_image<T> circle(const Point &q, double r, const T &inner, const T &outer) {
+            return [=](Point p) { return Detail::in_circle(p, q, r) ? inner : outer; };
+        }
+
+        template<typename T>
+        Base_image<T> checker(double d, const T &this_way, const T &that_way) {
+            return [=](Point p) { return Detail::is_this_checker(p, d) ? that_way : this_way; };
+        }
+
+        template<typename T>
+        Base_image<T> polar_checker(double d, int n, const T &this_way, const T &that_way) {
+            return [=](Point p) {
+                return compose(Detail::convert_polar_checker, Erased::checker(d, this_way, that_way))(p, n, d);
+            };
+        }
+
+        template<typename T>
+        Base_image<T> rings(const Point &q, double d, const T &this_way, const T &that_way) {
+            return [=](Point p) { return Detail::is_this_ring(p, q, d) ? this_way : that_way; };
+        }
+
+        Base_image<Color> cond(const Base_image<bool> &region, const Base_image<Color> &this_way,
+                               const Base_image<Color> &that_way) {
+            return [=](Point p) { return region(p) ? this_way(p) : that_way(p); };
+        }
+
+        Base_image<Color> lerp(const Base_image<Fraction> &blend, const Base_image<Color> &this_way,
+                               const Base_image<Color> &that_way) {
+            return lift(&Color::weighted_mean, this_way, that_way, blend);
+        }
+
+        Base_image<Color> darken(const Base_image<Color> &image, const Base_image<Fraction> &blend) {
+            return Erased::lerp(blend, image, Erased::constant(Colors::black));
+        }
+    }
+
+    // Builds the same scene with the combinators of either kind
+    struct Scene {
+        std::string name;
+        Image image;
+        Erased::Base_image<Color> erased;
+    };
+
+    std::vector<Scene> scenes() {
+        std::vector<Scene> result;
+
+        result.push_back({"checker", checker(10.0, Colors::white, Colors::black),
+                          Erased::checker(10.0, Colors::white, Colors::black)});
+
+        result.push_back({"transformed rings",
+                          rotate(translate(scale(rings(Point(5, 5), 8.0, Colors::red, Colors::blue), 1.5),
+                                           Vector(30, -20)), 0.4),
+                          Erased::rotate(Erased::translate(Erased::scale(
+                                  Erased::rings(Point(5, 5), 8.0, Colors::red, Colors::blue), 1.5),
+                                                           Vector(30, -20)), 0.4)});
+
+        result.push_back({"cond of circle",
+                          cond(circle(Point(0, 0), 200.0, true, false),
+                               polar_checker(10.0, 12, Colors::green, Colors::caramel),
+                               checker(16.0, Colors::white, Colors::black)),
+                          Erased::cond(Erased::circle(Point(0, 0), 200.0, true, false),
+                                       Erased::polar_checker(10.0, 12, Colors::green, Colors::caramel),
+                                       Erased::checker(16.0, Colors::white, Colors::black))});
+
+        result.push_back({"darkened lerp",
+                          darken(lerp(rotate(circle(Point(50, 0), 150.0, 0.8, 0.2), 0.3),
+                                      rings(Point(0, 0), 12.0, Colors::red, Colors::blue),
+                                      scale(checker(8.0, Colors::white, Colors::caramel), 2.0)), constant(0.3)),
+                          Erased::darken(Erased::lerp(Erased::rotate(Erased::circle(Point(50, 0), 150.0, 0.8, 0.2),
+                                                                     0.3),
+                                                      Erased::rings(Point(0, 0), 12.0, Colors::red, Colors::blue),
+                                                      Erased::scale(Erased::checker(8.0, Colors::white,
+                                                                                    Colors::caramel), 2.0)),
+                                         Erased::constant(0.3))});
+
+        return result;
+    }
+
+    // Renders the image by calling it at every pixel, like render places pixels
+    template<typename Image>
+    void render_points(const Image &image, unsigned char *buffer) {
+        for (std::size_t y = 0; y < HEIGHT; y++) {
+            for (std::size_t x = 0; x < WIDTH; x++) {
+                Color color = image(Point(double(x) - double(WIDTH) / 2, double(HEIGHT) / 2 - double(y)));
+                unsigned char *pixel = buffer + 3 * (y * WIDTH + x);
+                pixel[0] = color.red;
+                pixel[1] = color.green;
+                pixel[2] = color.blue;
+            }
+        }
+    }
+
+    // Megapixels per second of the best of the repeats
+    template<typename Render>
+    double speed(Render render) {
+        double best = 0;
+
+        for (std::size_t repeat = 0; repeat < REPEATS; repeat++) {
+            auto begin = std::chrono::steady_clock::now();
+            render();
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            best = repeat == 0 ? time : std::min(best, time);
+        }
+
+        return WIDTH * HEIGHT / best / 1e6;
+    }
+}
+
+int main() {
+    std::vector<unsigned char> points(3 * WIDTH * HEIGHT), blocks(3 * WIDTH * HEIGHT);
+    Render_options options;
+    options.threads = 1;
+
+    std::cout << std::left << std::setw(20) << "scene" << std::right << std::setw(16) << "std::function"
+              << std::setw(12) << "points" << std::setw(12) << "blocks" << "  (Mpixel/s)\n";
+
+    for (const Scene &scene : scenes()) {
+        double erased = speed([&] {
+            render_points(scene.erased, points.data());
+        });
+
+        double point = speed([&] {
+            render_points(scene.image, points.data());
+        });
+
+        double block = speed([&] {
+            render(scene.image, WIDTH, HEIGHT, blocks.data(), options);
+        });
+
+        if (points != blocks) {
+            std::cout << scene.name << ": blocks differ from points\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cout << std::left << std::setw(20) << scene.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(16) << erased << std::setw(12) << point << std::setw(12) << block << '\n';
+    }
+}
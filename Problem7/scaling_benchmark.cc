@@ -0,0 +1,154 @@
+// Speedup of rendering with more threads, on a scene of uniform cost and on scenes whose cost per pixel
+// is uneven across the frame. Tiles with work stealing are compared with splitting the frame
+// into one band of rows per thread. As speedups can only be measured on as many cores as there are,
+// the speedup which bands could reach on enough cores is also given, from the times of single bands.
+// Build: g++ -std=c++17 -O2 -pthread scaling_benchmark.cc images.cc render.cc profile.cc -o scaling_benchmark
+// Run: ./scaling_benchmark [max threads]
+#include "render.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    const std::size_t WIDTH = 1280;
+    const std::size_t HEIGHT = 720;
+    const std::size_t REPEATS = 3;
+
+    // Blend whose cost is much higher than that of any combinator
+    Blend waves() {
+        return [](const Point p) {
+            double sum = 0;
+
+            for (int i = 0; i < 24; i++) {
+                sum += std::sin(p.first / (20 + i)) * std::cos(p.second / (30 + i));
+            }
+
+            return std::abs(sum) / 24;
+        };
+    }
+
+    struct Scene {
+        std::string name;
+        Image image;
+    };
+
+    std::vector<Scene> scenes() {
+        Image expensive = lerp(waves(), rings(Point(0, 0), 9.0, Colors::red, Colors::blue),
+                               checker(13.0, Colors::white, Colors::black));
+        Image cheap = constant(Colors::caramel);
+
+        return {{"uniform", expensive},
+                // Only the top quarter of the frame is expensive
+                {"cond, top band", cond([](const Point p) { return p.second > double(HEIGHT) / 4; },
+                                        expensive, cheap)},
+                // Only a circle in the top left corner is expensive
+                {"cond of circle", cond(circle(Point(-400, 200), 200.0, true, false), expensive, cheap)}};
+    }
+
+    // Renders one band of rows per thread
+    void render_bands(const Image &image, unsigned char *buffer, std::size_t threads) {
+        Render_options options;
+        options.threads = 1;
+        std::vector<std::thread> workers;
+
+        for (std::size_t i = 1; i < threads; i++) {
+            workers.emplace_back([&, i] {
+                std::size_t top = HEIGHT * i / threads;
+                render(image, WIDTH, HEIGHT, top, HEIGHT * (i + 1) / threads, buffer + 3 * WIDTH * top, options);
+            });
+        }
+
+        render(image, WIDTH, HEIGHT, 0, HEIGHT / threads, buffer, options);
+
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Speedup which bands could reach at most, with every band rendered on a core of its own:
+    // the time of all of them over the time of the slowest one
+    double band_bound(const Image &image, unsigned char *buffer, std::size_t threads) {
+        Render_options options;
+        options.threads = 1;
+        double total = 0;
+        double slowest = 0;
+
+        for (std::size_t i = 0; i < threads; i++) {
+            std::size_t top = HEIGHT * i / threads;
+            auto begin = std::chrono::steady_clock::now();
+            render(image, WIDTH, HEIGHT, top, HEIGHT * (i + 1) / threads, buffer + 3 * WIDTH * top, options);
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            total += time;
+            slowest = std::max(slowest, time);
+        }
+
+        return total / slowest;
+    }
+
+    // Seconds of the best of the repeats
+    template<typename Render>
+    double measure(Render render) {
+        double best = 0;
+
+        for (std::size_t repeat = 0; repeat < REPEATS; repeat++) {
+            auto begin = std::chrono::steady_clock::now();
+            render();
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            best = repeat == 0 ? time : std::min(best, time);
+        }
+
+        return best;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t max_threads = argc > 1 ? std::stoul(argv[1]) : std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<unsigned char> expected(3 * WIDTH * HEIGHT), pixels(3 * WIDTH * HEIGHT);
+
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << '\n';
+
+    for (const Scene &scene : scenes()) {
+        Render_options options;
+        options.threads = 1;
+        double single = measure([&] {
+            render(scene.image, WIDTH, HEIGHT, expected.data(), options);
+        });
+
+        std::cout << scene.name << ", " << std::fixed << std::setprecision(3) << single << " s on one thread\n"
+                  << std::setw(10) << "threads" << std::setw(12) << "tiles" << std::setw(12) << "bands"
+                  << std::setw(16) << "bands at most" << "  (speedup)\n";
+
+        for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+            options.threads = threads;
+
+            double tiles = measure([&] {
+                render(scene.image, WIDTH, HEIGHT, pixels.data(), options);
+            });
+
+            if (pixels != expected) {
+                std::cout << "tiles differ\n";
+                return EXIT_FAILURE;
+            }
+
+            double bands = measure([&] {
+                render_bands(scene.image, pixels.data(), threads);
+            });
+
+            if (pixels != expected) {
+                std::cout << "bands differ\n";
+                return EXIT_FAILURE;
+            }
+
+            std::cout << std::setprecision(2) << std::setw(10) << threads << std::setw(12) << single / tiles
+                      << std::setw(12) << single / bands << std::setw(16)
+                      << band_bound(scene.image, pixels.data(), threads) << '\n';
+        }
+    }
+}
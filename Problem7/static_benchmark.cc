@@ -0,0 +1,238 @@
+// Cost per pixel of a 20-layer scene built with the statically typed combinators from static_images.h,
+// with every layer erased into a std::function, with the whole scene erased into a Base_image,
+// and built with the combinators from images.h,
+// evaluated per point and rendered in blocks, on one thread.
+// Build: g++ -std=c++17 -O2 -pthread static_benchmark.cc images.cc render.cc profile.cc -o static_benchmark
+#include "render.h"
+#include "static_images.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+    const std::size_t WIDTH = 640;
+    const std::size_t HEIGHT = 480;
+    const std::size_t LAYERS = 20;
+    const std::size_t REPEATS = 3;
+
+    // Combinators used by the scene, from images.h
+    struct Nodes {
+        template<typename T>
+        static Base_image<T> circle(const Point &q, double r, const T &inner, const T &outer) {
+            return ::circle(q, r, inner, outer);
+        }
+
+        template<typename T>
+        static Base_image<T> rings(const Point &q, double d, const T &this_way, const T &that_way) {
+            return ::rings(q, d, this_way, that_way);
+        }
+
+        template<typename T>
+        static Base_image<T> checker(double d, const T &this_way, const T &that_way) {
+            return ::checker(d, this_way, that_way);
+        }
+
+        static Image rotate(const Image &image, double phi) {
+            return ::rotate(image, phi);
+        }
+
+        static Image translate(const Image &image, const Vector &vector) {
+            return ::translate(image, vector);
+        }
+
+        static Image cond(const Region &region, const Image &this_way, const Image &that_way) {
+            return ::cond(region, this_way, that_way);
+        }
+
+        static Image lerp(const Blend &blend, const Image &this_way, const Image &that_way) {
+            return ::lerp(blend, this_way, that_way);
+        }
+    };
+
+    // The same combinators from static_images.h
+    struct Typed {
+        template<typename T>
+        static auto circle(const Point &q, double r, const T &inner, const T &outer) {
+            return Static::circle(q, r, inner, outer);
+        }
+
+        template<typename T>
+        static auto rings(const Point &q, double d, const T &this_way, const T &that_way) {
+            return Static::rings(q, d, this_way, that_way);
+        }
+
+        template<typename T>
+        static auto checker(double d, const T &this_way, const T &that_way) {
+            return Static::checker(d, this_way, that_way);
+        }
+
+        template<typename F>
+        static auto rotate(const F &image, double phi) {
+            return Static::rotate(image, phi);
+        }
+
+        template<typename F>
+        static auto translate(const F &image, const Vector &vector) {
+            return Static::translate(image, vector);
+        }
+
+        template<typename R, typename F, typename G>
+        static auto cond(const R &region, const F &this_way, const G &that_way) {
+            return Static::cond(region, this_way, that_way);
+        }
+
+        template<typename B, typename F, typename G>
+        static auto lerp(const B &blend, const F &this_way, const G &that_way) {
+            return Static::lerp(blend, this_way, that_way);
+        }
+    };
+
+    // The same combinators erasing the type of every layer into a std::function, as images were before nodes
+    struct Functions {
+        template<typename T>
+        using Function = std::function<T(const Point)>;
+
+        template<typename T>
+        static Function<T> circle(const Point &q, double r, const T &inner, const T &outer) {
+            return Static::circle(q, r, inner, outer);
+        }
+
+        template<typename T>
+        static Function<T> rings(const Point &q, double d, const T &this_way, const T &that_way) {
+            return Static::rings(q, d, this_way, that_way);
+        }
+
+        template<typename T>
+        static Function<T> checker(double d, const T &this_way, const T &that_way) {
+            return Static::checker(d, this_way, that_way);
+        }
+
+        static Function<Color> rotate(const Function<Color> &image, double phi) {
+            return Static::rotate(image, phi);
+        }
+
+        static Function<Color> translate(const Function<Color> &image, const Vector &vector) {
+            return Static::translate(image, vector);
+        }
+
+        static Function<Color> cond(const Function<bool> &region, const Function<Color> &this_way,
+                                    const Function<Color> &that_way) {
+            return Static::cond(region, this_way, that_way);
+        }
+
+        static Function<Color> lerp(const Function<Fraction> &blend, const Function<Color> &this_way,
+                                    const Function<Color> &that_way) {
+            return Static::lerp(blend, this_way, that_way);
+        }
+    };
+
+    // Layers from the given one to the top over the image, alternately rotating, translating,
+    // cutting out a circle of rings and blending with a checker
+    template<typename Api, std::size_t Layer, typename F>
+    auto scene(const F &image) {
+        if constexpr (Layer == LAYERS) {
+            return image;
+        } else {
+            double k = double(Layer);
+
+            if constexpr (Layer % 4 == 0) {
+                return scene<Api, Layer + 1>(Api::rotate(image, 0.05 * k));
+            } else if constexpr (Layer % 4 == 1) {
+                return scene<Api, Layer + 1>(Api::translate(image, Vector(3 * k, -2 * k)));
+            } else if constexpr (Layer % 4 == 2) {
+                return scene<Api, Layer + 1>(Api::cond(Api::circle(Point(10 * k - 100, 5 * k), 40 + 4 * k, true, false),
+                                                       Api::rings(Point(0, 0), 4 + k, Colors::red, Colors::blue),
+                                                       image));
+            } else {
+                return scene<Api, Layer + 1>(Api::lerp(Api::circle(Point(-8 * k, 60), 120.0, 0.25, 0.75), image,
+                                                       Api::checker(6 + k, Colors::caramel, Colors::green)));
+            }
+        }
+    }
+
+    // Renders the image by calling it at every pixel, like render places pixels
+    template<typename Image>
+    void render_points(const Image &image, unsigned char *buffer) {
+        for (std::size_t y = 0; y < HEIGHT; y++) {
+            for (std::size_t x = 0; x < WIDTH; x++) {
+                Color color = image(Point(double(x) - double(WIDTH) / 2, double(HEIGHT) / 2 - double(y)));
+                unsigned char *pixel = buffer + 3 * (y * WIDTH + x);
+                pixel[0] = color.red;
+                pixel[1] = color.green;
+                pixel[2] = color.blue;
+            }
+        }
+    }
+
+    // Nanoseconds per pixel of the best of the repeats
+    template<typename Render>
+    double cost(Render render) {
+        double best = 0;
+
+        for (std::size_t repeat = 0; repeat < REPEATS; repeat++) {
+            auto begin = std::chrono::steady_clock::now();
+            render();
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            best = repeat == 0 ? time : std::min(best, time);
+        }
+
+        return best / (WIDTH * HEIGHT) * 1e9;
+    }
+
+    void print(const char *name, double nanoseconds) {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << nanoseconds << " ns/pixel\n";
+    }
+}
+
+int main() {
+    auto typed = scene<Typed, 0>(Static::checker(10.0, Colors::white, Colors::black));
+    Image erased = Static::erase(typed);
+    Functions::Function<Color> functions = scene<Functions, 0>(
+            Functions::Function<Color>(Static::checker(10.0, Colors::white, Colors::black)));
+    Image nodes = scene<Nodes, 0>(checker(10.0, Colors::white, Colors::black));
+
+    std::vector<unsigned char> expected(3 * WIDTH * HEIGHT), pixels(3 * WIDTH * HEIGHT);
+    Render_options options;
+    options.threads = 1;
+
+    print("std::function per layer", cost([&] {
+        render_points(functions, pixels.data());
+    }));
+
+    print("static", cost([&] {
+        render_points(typed, expected.data());
+    }));
+
+    print("static, erased", cost([&] {
+        render_points(erased, pixels.data());
+    }));
+
+    if (pixels != expected) {
+        std::cout << "erased image differs\n";
+        return EXIT_FAILURE;
+    }
+
+    print("nodes, per point", cost([&] {
+        render_points(nodes, pixels.data());
+    }));
+
+    if (pixels != expected) {
+        std::cout << "image made of nodes differs\n";
+        return EXIT_FAILURE;
+    }
+
+    print("nodes, rendered", cost([&] {
+        render(nodes, WIDTH, HEIGHT, expected.data(), options);
+    }));
+
+    if (pixels != expected) {
+        std::cout << "rendered image differs\n";
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef STATIC_IMAGES_H
+#define STATIC_IMAGES_H
+
+#include "images.h"
+
+#include <type_traits>
+#include <utility>
+
+// Images as concrete callable types, mirroring the functions from images.h. A scene built with them
+// is a single type that holds its layers by value, so it needs no allocation and the compiler
+// can inline it whole. Any callable image, also a Base_image, can be used as an argument.
+namespace Static {
+    // compose and lift from functional.h already return concrete lambdas
+    using ::compose;
+    using ::lift;
+
+    // Converts an image into a type erased Base_image
+    template<typename F>
+    auto erase(F image) {
+        return Base_image<std::decay_t<decltype(image(std::declval<const Point>()))>>(std::move(image));
+    }
+
+    template<typename T>
+    auto constant(const T &t) {
+        return [=](const Point) { return t; };
+    }
+
+    // Image transformed by an affine map, like transforms from images.h
+    template<typename F>
+    struct Transformed {
+        F image;
+        Detail::Affine affine;
+
+        auto operator()(const Point p) const {
+            return image(affine(p));
+        }
+    };
+
+    template<typename F>
+    auto transform(const F &image, const Detail::Affine &affine) {
+        return Transformed<F>{image, affine};
+    }
+
+    // Transforms of a transformed image fold into its map
+    template<typename F>
+    auto transform(const Transformed<F> &image, const Detail::Affine &affine) {
+        return Transformed<F>{image.image, affine.then(image.affine)};
+    }
+
+    template<typename F>
+    auto rotate(const F &image, double phi) {
+        return Static::transform(image, Detail::Affine::rotation(phi));
+    }
+
+    template<typename F>
+    auto translate(const F &image, const Vector &vector) {
+        return Static::transform(image, Detail::Affine::translation(vector));
+    }
+
+    template<typename F>
+    auto scale(const F &image, double s) {
+        assert(s != 0);
+
+        return Static::transform(image, Detail::Affine::scaling(s));
+    }
+
+    template<typename T>
+    auto circle(const Point &q, double r, const T &inner, const T &outer) {
+        return [=](const Point p) { return Detail::in_circle(p, q, r) ? inner : outer; };
+    }
+
+    template<typename T>
+    auto checker(double d, const T &this_way, const T &that_way) {
+        assert(d != 0);
+
+        return [=](const Point p) { return Detail::is_this_checker(p, d) ? that_way : this_way; };
+    }
+
+    template<typename T>
+    auto polar_checker(double d, int n, const T &this_way, const T &that_way) {
+        assert(d != 0);
+
+        return [=](const Point p) {
+            return Detail::is_this_checker(Detail::convert_polar_checker(p, n, d), d) ? that_way : this_way;
+        };
+    }
+
+    template<typename T>
+    auto rings(const Point &q, double d, const T &this_way, const T &that_way) {
+        return [=](const Point p) { return Detail::is_this_ring(p, q, d) ? this_way : that_way; };
+    }
+
+    template<typename T>
+    auto vertical_stripe(double d, const T &this_way, const T &that_way) {
+        return [=](const Point p) { return Detail::is_stripe(p, d) ? this_way : that_way; };
+    }
+
+    template<typename R, typename F, typename G>
+    auto cond(const R &region, const F &this_way, const G &that_way) {
+        return [=](const Point p) { return region(p) ? this_way(p) : that_way(p); };
+    }
+
+    template<typename B, typename F, typename G>
+    auto lerp(const B &blend, const F &this_way, const G &that_way) {
+        return [=](const Point p) { return this_way(p).weighted_mean(that_way(p), blend(p)); };
+    }
+
+    template<typename F, typename B>
+    auto darken(const F &image, const B &blend) {
+        return Static::lerp(blend, image, Static::constant(Colors::black));
+    }
+
+    template<typename F, typename B>
+    auto lighten(const F &image, const B &blend) {
+        return Static::lerp(blend, image, Static::constant(Colors::white));
+    }
+}
+
+#endif //STATIC_IMAGES_H
@@ -0,0 +1,143 @@
+// Cost per pixel of chains of rotate, translate and scale over rings: transforming the point in every layer
+// through polar coordinates, as the transforms did before, with an affine map in every layer,
+// and with the chain folded into one map. Evaluated per point and rendered in blocks, on one thread.
+// Build: g++ -std=c++17 -O2 -pthread transform_benchmark.cc images.cc render.cc profile.cc -o transform_benchmark
+#include "render.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace {
+    const std::size_t WIDTH = 640;
+    const std::size_t HEIGHT = 480;
+    const std::size_t REPEATS = 3;
+
+    using Function = std::function<Color(const Point)>;
+
+    // Layer i of a chain: a rotation, a translation or a scaling, undone by the layer i + 3 of the chain
+    Detail::Affine affine(std::size_t i) {
+        double k = double(i / 6 + 1);
+        bool undo = i % 6 >= 3;
+
+        switch (i % 3) {
+            case 0:
+                return Detail::Affine::rotation(undo ? -0.1 * k : 0.1 * k);
+            case 1:
+                return Detail::Affine::translation(undo ? Vector(-5 * k, 3 * k) : Vector(5 * k, -3 * k));
+            default:
+                return Detail::Affine::scaling(undo ? 1 / (1 + 0.1 * k) : 1 + 0.1 * k);
+        }
+    }
+
+    Function polar(const Function &image, std::size_t i) {
+        double k = double(i / 6 + 1);
+        bool undo = i % 6 >= 3;
+
+        switch (i % 3) {
+            case 0:
+                return [=](const Point p) { return image(Detail::rotate(p, undo ? -0.1 * k : 0.1 * k)); };
+            case 1: {
+                Vector vector = undo ? Vector(-5 * k, 3 * k) : Vector(5 * k, -3 * k);
+
+                return [=](const Point p) { return image(Detail::add(p, vector)); };
+            }
+            default:
+                return [=](const Point p) { return image(Detail::scale(p, undo ? 1 / (1 + 0.1 * k) : 1 + 0.1 * k)); };
+        }
+    }
+
+    // Renders the image by calling it at every pixel, like render places pixels
+    template<typename Image>
+    void render_points(const Image &image, unsigned char *buffer) {
+        for (std::size_t y = 0; y < HEIGHT; y++) {
+            for (std::size_t x = 0; x < WIDTH; x++) {
+                Color color = image(Point(double(x) - double(WIDTH) / 2, double(HEIGHT) / 2 - double(y)));
+                unsigned char *pixel = buffer + 3 * (y * WIDTH + x);
+                pixel[0] = color.red;
+                pixel[1] = color.green;
+                pixel[2] = color.blue;
+            }
+        }
+    }
+
+    // Nanoseconds per pixel of the best of the repeats
+    template<typename Render>
+    double cost(Render render) {
+        double best = 0;
+
+        for (std::size_t repeat = 0; repeat < REPEATS; repeat++) {
+            auto begin = std::chrono::steady_clock::now();
+            render();
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            best = repeat == 0 ? time : std::min(best, time);
+        }
+
+        return best / (WIDTH * HEIGHT) * 1e9;
+    }
+
+    // Percent of pixels which differ
+    double difference(const std::vector<unsigned char> &first, const std::vector<unsigned char> &second) {
+        std::size_t different = 0;
+
+        for (std::size_t i = 0; i < first.size(); i += 3) {
+            different += !std::equal(&first[i], &first[i] + 3, &second[i]);
+        }
+
+        return 100.0 * different / (WIDTH * HEIGHT);
+    }
+}
+
+int main() {
+    Image base = rings(Point(20, 10), 6.0, Colors::red, Colors::blue);
+    std::vector<unsigned char> polar_pixels(3 * WIDTH * HEIGHT), layered_pixels(3 * WIDTH * HEIGHT);
+    std::vector<unsigned char> fused_pixels(3 * WIDTH * HEIGHT), rendered_pixels(3 * WIDTH * HEIGHT);
+    Render_options options;
+    options.threads = 1;
+
+    std::cout << std::setw(10) << "layers" << std::setw(12) << "polar" << std::setw(12) << "affine"
+              << std::setw(12) << "fused" << std::setw(12) << "rendered" << std::setw(16) << "polar differs"
+              << "  (ns/pixel)\n";
+
+    for (std::size_t layers : {1, 3, 6, 12, 36}) {
+        Function polar_chain = base;
+        Image layered = base;
+        Image fused = base;
+
+        for (std::size_t i = 0; i < layers; i++) {
+            polar_chain = polar(polar_chain, i);
+            layered = Image(std::make_shared<Detail::Affine_node<Color>>(layered, affine(i)));
+            fused = Detail::transform(fused, affine(i));
+        }
+
+        double polar_cost = cost([&] {
+            render_points(polar_chain, polar_pixels.data());
+        });
+
+        double layered_cost = cost([&] {
+            render_points(layered, layered_pixels.data());
+        });
+
+        double fused_cost = cost([&] {
+            render_points(fused, fused_pixels.data());
+        });
+
+        double rendered_cost = cost([&] {
+            render(fused, WIDTH, HEIGHT, rendered_pixels.data(), options);
+        });
+
+        if (rendered_pixels != fused_pixels) {
+            std::cout << "rendered image differs\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cout << std::fixed << std::setprecision(1) << std::setw(10) << layers << std::setw(12) << polar_cost
+                  << std::setw(12) << layered_cost << std::setw(12) << fused_cost << std::setw(12) << rendered_cost
+                  << std::setw(15) << difference(polar_pixels, fused_pixels) << "%\n";
+    }
+}